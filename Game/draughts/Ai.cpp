@@ -0,0 +1 @@
+#include "Ai.hpp"
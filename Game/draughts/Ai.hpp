@@ -0,0 +1,463 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+
+#include "BitBoard.hpp"
+#include "Evaluation.hpp"
+#include "HashHistory.hpp"
+#include "Mcts.hpp"
+#include "Network.hpp"
+#include "OpeningBook.hpp"
+#include "ParallelSearch.hpp"
+#include "Search.hpp"
+#include "SearchLog.hpp"
+#include "Tablebase.hpp"
+#include "TranspositionTable.hpp"
+
+/**
+ * Computer player, searching for a move within a fixed time budget.
+ *
+ * Searches run one after the other on a worker thread that lives as long as the player, fed by a queue of
+ * tasks. Every task has its own stop flag, so a search can be cut short at any time and a stop can't be
+ * lost to or leak into another search.
+ */
+class Ai
+{
+public:
+    // Called from the worker thread after every completed iteration, with the best move so far
+    using Progress = std::function<void(const Search::Result&)>;
+    
+    enum class Engine
+    {
+        AlphaBeta,
+        MonteCarlo
+    };
+
+public:
+    Ai(std::chrono::milliseconds timeBudget, size_t hashMegabytes, size_t threads = std::thread::hardware_concurrency())
+        : _table(std::make_shared<TranspositionTable>(hashMegabytes))
+        , _search(_table, threads)
+    {
+        _limits.time = timeBudget;
+        _worker = std::thread([this]() {
+            work();
+        });
+    }
+    
+    ~Ai()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _quit = true;
+            for (auto&& task : _tasks) {
+                task->stop = true;
+            }
+            if (_running) {
+                _running->stop = true;
+            }
+        }
+        _condition.notify_all();
+        _worker.join();
+    }
+    
+    std::shared_ptr<std::future<ParallelSearch::Result>> future()
+    {
+        return _future;
+    }
+    
+    void reset()
+    {
+        _future = nullptr;
+    }
+    
+    void findOptimalMoveAsync(const BitBoard& bitBoard, Progress progress = nullptr)
+    {
+        findOptimalMoveAsync(bitBoard, HashHistory(bitBoard), progress);
+    }
+    
+    /**
+     * Starts searching for a move, the result is handed out by `future`. `positions` are the positions of
+     * the game so far, both searches score repeating them as a draw. When the position is the one
+     * being pondered that search becomes the search for the move instead.
+     */
+    void findOptimalMoveAsync(const BitBoard& bitBoard, const HashHistory& positions, Progress progress = nullptr)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        std::shared_ptr<Task> task;
+        if (_ponder && sameBoard(_ponder->board, bitBoard)) {
+            // The ponder search now has what is left of the time budget, counted from when it started
+            task = _ponder;
+            task->progress = progress;
+            task->answer = true;
+            task->pondering = false;
+        } else {
+            if (_ponder) {
+                _ponder->stop = true;
+            }
+            
+            task = std::make_shared<Task>(Task::Kind::Search, bitBoard, positions, _limits, progress);
+            task->answer = true;
+            _tasks.push_back(task);
+            _condition.notify_all();
+        }
+        _ponder = nullptr;
+        _move = task;
+        
+        _future = std::make_shared<std::future<ParallelSearch::Result>>(task->promise.get_future());
+        if (task->done) {
+            task->promise.set_value(task->result);
+        }
+    }
+    
+    ParallelSearch::Result findOptimalMove(const BitBoard& bitBoard, Progress progress = nullptr)
+    {
+        return findOptimalMove(bitBoard, HashHistory(bitBoard), progress);
+    }
+    
+    ParallelSearch::Result findOptimalMove(const BitBoard& bitBoard, const HashHistory& positions, Progress progress = nullptr)
+    {
+        findOptimalMoveAsync(bitBoard, positions, progress);
+        auto result = _future->get();
+        _future = nullptr;
+        return result;
+    }
+    
+    /**
+     * Stops the search for a move, which then hands out the best move found so far.
+     */
+    void moveNow()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_move) {
+            _move->stop = true;
+        }
+    }
+    
+    /**
+     * Thinks on the opponent's time. Called with the position after our move, it guesses the opponent's
+     * reply from the transposition table and searches the position after it until our next move is asked
+     * for. If the guess was right that search continues and has a head start, otherwise it is stopped and
+     * only the positions it left in the table help the next search.
+     */
+    void ponder(const BitBoard& bitBoard)
+    {
+        ponder(bitBoard, HashHistory(bitBoard));
+    }
+    
+    void ponder(const BitBoard& bitBoard, const HashHistory& positions)
+    {
+        stopPondering();
+        
+        BitBoard::Move reply;
+        if (!expectedReply(bitBoard, reply)) {
+            return;
+        }
+        
+        BitBoard ponderBoard = bitBoard.apply(reply);
+        BitBoard::MoveList moves;
+        ponderBoard.generate(moves);
+        if (moves.empty() || (_book && !_book->moves(ponderBoard).empty())) {
+            return;
+        }
+        
+        HashHistory ponderPositions = positions;
+        ponderPositions.push(ponderBoard.hash, HashHistory::irreversible(bitBoard, reply));
+        
+        std::lock_guard<std::mutex> lock(_mutex);
+        _ponder = std::make_shared<Task>(Task::Kind::Ponder, ponderBoard, ponderPositions, _limits, nullptr);
+        _ponder->pondering = true;
+        _tasks.push_back(_ponder);
+        _condition.notify_all();
+    }
+    
+    /**
+     * Stops thinking on the opponent's time, waiting for the search to finish.
+     */
+    void stopPondering()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (!_ponder) {
+            return;
+        }
+        
+        auto task = _ponder;
+        _ponder = nullptr;
+        task->stop = true;
+        _done.wait(lock, [&task]() {
+            return task->done;
+        });
+    }
+    
+    bool pondering() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _ponder != nullptr;
+    }
+    
+    Search::Limits& limits()
+    {
+        return _limits;
+    }
+    
+    ParallelSearch& search()
+    {
+        return _search;
+    }
+    
+    /**
+     * Switches between the alpha-beta search and Monte Carlo tree search, which by default uses as many
+     * threads as the alpha-beta search. Both use the same evaluation and opening book, but only the
+     * alpha-beta search fills the transposition table that pondering guesses the opponent's reply from.
+     */
+    void setEngine(Engine engine)
+    {
+        Mcts::Options options;
+        options.threads = _search.threads();
+        setEngine(engine, options);
+    }
+    
+    void setEngine(Engine engine, const Mcts::Options& options)
+    {
+        waitUntilIdle();
+        _engine = engine;
+        if (engine == Engine::MonteCarlo) {
+            _mcts = std::make_unique<Mcts>(options);
+            _mcts->setEvaluation(_search.evaluation());
+        } else {
+            _mcts = nullptr;
+        }
+    }
+    
+    /**
+     * Replaces the default evaluation weights by the ones in a weights file, see `Evaluation::load`.
+     */
+    void loadWeights(const std::string& path)
+    {
+        waitUntilIdle();
+        _search.setEvaluation(Evaluation(Evaluation::load(path)));
+        if (_mcts) {
+            _mcts->setEvaluation(_search.evaluation());
+        }
+    }
+    
+    /**
+     * Evaluates positions with a neural network instead of the evaluation weights, see `Network`. Only the
+     * alpha-beta search uses it.
+     */
+    void loadNetwork(const std::string& path)
+    {
+        waitUntilIdle();
+        _search.setNetwork(std::make_shared<const Network>(path));
+    }
+    
+    /**
+     * Maps the endgame tables in the directory, positions in them are no longer searched.
+     */
+    void loadTablebase(const std::string& directory)
+    {
+        waitUntilIdle();
+        _search.setTablebase(std::make_shared<const Tablebase>(directory));
+    }
+    
+    /**
+     * Maps an opening book, positions in it are answered with one of its moves instead of searched.
+     */
+    void loadBook(const std::string& path)
+    {
+        waitUntilIdle();
+        _book = std::make_shared<const OpeningBook>(path);
+    }
+    
+    /**
+     * Appends the statistics of every search to a file as JSON lines, see `SearchLog`. An empty path stops
+     * writing them.
+     */
+    void setSearchLog(const std::string& path)
+    {
+        waitUntilIdle();
+        _searchLog = path.empty() ? nullptr : std::make_unique<SearchLog>(path);
+    }
+    
+    /**
+     * Forgets everything learned in earlier searches, for starting a new game.
+     */
+    void clear()
+    {
+        waitUntilIdle();
+        _table->clear();
+    }
+
+private:
+    struct Task
+    {
+        enum class Kind
+        {
+            Search,
+            Ponder
+        };
+        
+        Task(Kind kind, const BitBoard& board, const HashHistory& positions, const Search::Limits& limits, Progress progress)
+            : kind(kind)
+            , board(board)
+            , positions(positions)
+            , limits(limits)
+            , progress(progress)
+        {
+        
+        }
+        
+        Kind kind;
+        BitBoard board;
+        HashHistory positions;
+        Search::Limits limits;
+        std::atomic<bool> stop{false};
+        std::atomic<bool> pondering{false};
+        
+        // Guarded by the mutex of the Ai
+        Progress progress;
+        bool answer{false};
+        bool done{false};
+        std::promise<ParallelSearch::Result> promise;
+        ParallelSearch::Result result;
+    };
+
+private:
+    void work()
+    {
+        while (true) {
+            std::shared_ptr<Task> task;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _condition.wait(lock, [this]() {
+                    return _quit || !_tasks.empty();
+                });
+                if (_quit) {
+                    return;
+                }
+                
+                task = _tasks.front();
+                _tasks.pop_front();
+                _running = task;
+            }
+            
+            auto result = run(*task);
+            
+            std::lock_guard<std::mutex> lock(_mutex);
+            task->result = result;
+            task->done = true;
+            if (task->answer) {
+                task->promise.set_value(result);
+            }
+            _running = nullptr;
+            _done.notify_all();
+        }
+    }
+    
+    ParallelSearch::Result run(Task& task)
+    {
+        ParallelSearch::Result result;
+        if (task.kind == Task::Kind::Search && _book && _book->pick(task.board, result.best.move, _random)) {
+            result.best.fromBook = true;
+            return result;
+        }
+        
+        Search::Limits limits = task.limits;
+        limits.stop = &task.stop;
+        limits.pondering = &task.pondering;
+        limits.progress = [this, &task](const Search::Result& progress) {
+            Progress callback;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                callback = task.progress;
+            }
+            if (callback) {
+                callback(progress);
+            }
+        };
+        
+        if (_engine == Engine::MonteCarlo) {
+            result.best = _mcts->run(task.board, task.positions, limits);
+        } else {
+            result = _search.run(task.board, task.positions, limits);
+        }
+        if (_searchLog && (task.kind == Task::Kind::Search || !task.pondering)) {
+            _searchLog->write(SearchLog::json(result));
+        }
+        
+        return result;
+    }
+    
+    void waitUntilIdle()
+    {
+        stopPondering();
+        
+        std::unique_lock<std::mutex> lock(_mutex);
+        _done.wait(lock, [this]() {
+            return _tasks.empty() && !_running;
+        });
+    }
+    
+    static bool sameBoard(const BitBoard& a, const BitBoard& b)
+    {
+        return a.hash == b.hash && a.white == b.white && a.black == b.black && a.kings == b.kings && a.turn == b.turn;
+    }
+    
+    /**
+     * The reply the last search expects from the opponent, which is the best move stored for the position.
+     */
+    bool expectedReply(const BitBoard& bitBoard, BitBoard::Move& reply) const
+    {
+        BitBoard::MoveList moves;
+        bitBoard.generate(moves);
+        if (moves.size() == 1) {
+            reply = moves[0];
+            return true;
+        }
+        
+        TranspositionTable::Entry entry;
+        if (!_table->probe(bitBoard.hash, entry) || entry.move >= moves.size()) {
+            return false;
+        }
+        
+        reply = moves[entry.move];
+        return true;
+    }
+
+private:
+    // Kept for the whole game, so the next turn starts with the results of this one
+    std::shared_ptr<TranspositionTable> _table;
+    ParallelSearch _search;
+    Search::Limits _limits;
+    Engine _engine{Engine::AlphaBeta};
+    std::unique_ptr<Mcts> _mcts;
+    std::shared_ptr<const OpeningBook> _book;
+    
+    // Picks between book moves, so games don't all follow the same line
+    std::mt19937_64 _random{std::random_device()()};
+    std::unique_ptr<SearchLog> _searchLog;
+    
+    std::shared_ptr<std::future<ParallelSearch::Result>> _future;
+    
+    mutable std::mutex _mutex;
+    std::condition_variable _condition;
+    std::condition_variable _done;
+    std::deque<std::shared_ptr<Task>> _tasks;
+    bool _quit{false};
+    
+    // The task being worked on, the search for the move asked for last and the search on the opponent's time
+    std::shared_ptr<Task> _running;
+    std::shared_ptr<Task> _move;
+    std::shared_ptr<Task> _ponder;
+    
+    std::thread _worker;
+};
@@ -0,0 +1 @@
+#include "BatchAnalysis.hpp"
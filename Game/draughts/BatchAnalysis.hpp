@@ -0,0 +1,128 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BitBoard.hpp"
+#include "Evaluation.hpp"
+#include "Search.hpp"
+#include "Tablebase.hpp"
+#include "TranspositionTable.hpp"
+
+/**
+ * Analyzes many positions at once, for running the engine over game archives. Every thread searches its
+ * own position with its own transposition table, which for many positions gets more done than all threads
+ * searching the same position. Positions are pulled from a source and results handed out as soon as they
+ * are done, so neither has to fit in memory.
+ */
+class BatchAnalysis
+{
+public:
+    struct Options
+    {
+        // Budget per position
+        Search::Limits limits;
+        
+        size_t threads{std::max(1u, std::thread::hardware_concurrency())};
+        
+        // Transposition table size per thread
+        size_t hashMegabytes{16};
+        
+        Evaluation evaluation;
+        std::shared_ptr<const Tablebase> tablebase;
+    };
+    
+    struct Position
+    {
+        std::string id;
+        BitBoard board;
+    };
+    
+    struct Result
+    {
+        // Order in which the position was taken from the source
+        size_t index{0};
+        std::string id;
+        BitBoard board;
+        Search::Result search;
+    };
+
+public:
+    BatchAnalysis(const Options& options)
+        : _options(options)
+    {
+    
+    }
+    
+    /**
+     * Analyzes positions taken from `next` until it returns false, calling `onResult` for each position in
+     * the order they finish. Neither callback is ever called from two threads at the same time. Returns
+     * the amount of positions analyzed.
+     */
+    size_t run(std::function<bool(Position&)> next, std::function<void(const Result&)> onResult)
+    {
+        std::mutex inputMutex;
+        std::mutex outputMutex;
+        size_t count = 0;
+        
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < std::max<size_t>(_options.threads, 1); ++i) {
+            workers.emplace_back([&]() {
+                auto table = std::make_shared<TranspositionTable>(_options.hashMegabytes);
+                Search search(table);
+                search.setEvaluation(_options.evaluation);
+                search.setTablebase(_options.tablebase);
+                
+                while (true) {
+                    Result result;
+                    {
+                        std::lock_guard<std::mutex> lock(inputMutex);
+                        Position position;
+                        if (!next(position)) {
+                            break;
+                        }
+                        
+                        result.index = count++;
+                        result.id = std::move(position.id);
+                        result.board = position.board;
+                    }
+                    
+                    // Only aged instead of cleared between positions. They go to whichever thread is free, so the
+                    // next position of a game usually lands on another thread and finds little in this table.
+                    table->newSearch();
+                    result.search = search.run(result.board, _options.limits);
+                    
+                    std::lock_guard<std::mutex> lock(outputMutex);
+                    onResult(result);
+                }
+            });
+        }
+        
+        for (auto&& worker : workers) {
+            worker.join();
+        }
+        
+        return count;
+    }
+    
+    size_t run(const std::vector<Position>& positions, std::function<void(const Result&)> onResult)
+    {
+        size_t next = 0;
+        return run([&](Position& position) {
+            if (next >= positions.size()) {
+                return false;
+            }
+            
+            position = positions[next++];
+            return true;
+        }, onResult);
+    }
+
+private:
+    Options _options;
+};
@@ -0,0 +1 @@
+#include "BatchEvaluation.hpp"
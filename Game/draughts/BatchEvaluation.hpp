@@ -0,0 +1,359 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+#include "BitBoard.hpp"
+#include "Evaluation.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BATCH_EVALUATION_AVX2
+#elif defined(__ARM_NEON) && defined(BATCH_EVALUATION_USE_NEON)
+// Not built on an ARM processor yet, so only compiled in when asked for
+#include <arm_neon.h>
+#define BATCH_EVALUATION_NEON
+#endif
+
+/**
+ * Positions stored as a structure of arrays, one array per bitboard, so a vector register loads the same
+ * bitboard of several positions at once.
+ */
+struct PositionBatch
+{
+    void add(const BitBoard& board)
+    {
+        white.push_back(board.white);
+        black.push_back(board.black);
+        kings.push_back(board.kings);
+        turn.push_back(board.turn);
+    }
+    
+    BitBoard board(size_t index) const
+    {
+        BitBoard board;
+        board.white = white[index];
+        board.black = black[index];
+        board.kings = kings[index];
+        board.turn = turn[index];
+        board.hash = board.computeHash();
+        return board;
+    }
+    
+    size_t size() const
+    {
+        return white.size();
+    }
+    
+    void clear()
+    {
+        white.clear();
+        black.clear();
+        kings.clear();
+        turn.clear();
+    }
+    
+    std::vector<uint64_t> white;
+    std::vector<uint64_t> black;
+    std::vector<uint64_t> kings;
+    std::vector<BitBoard::Color> turn;
+};
+
+/**
+ * Evaluates many positions at once, giving the same scores as `Evaluation::evaluate`.
+ *
+ * The square tables of the evaluation hold only a few distinct values per piece, so the squares are grouped
+ * by value and a position is scored with one population count per group instead of a table lookup per
+ * piece. That is the same work for every position, which vector instructions do for four positions at a
+ * time with AVX2 and two with NEON, the latter only when built with BATCH_EVALUATION_USE_NEON. AVX2 is
+ * picked when the processor has it.
+ *
+ * One position at a time the counts are slower than the table lookups of `Evaluation`, so there is no
+ * scalar version of them. The scalar kernel, positions left over and processors without either vector
+ * kernel just call `Evaluation::evaluate`.
+ */
+class BatchEvaluation
+{
+public:
+    enum class Kernel
+    {
+        Scalar,
+        Avx2,
+        Neon
+    };
+
+public:
+    BatchEvaluation()
+        : BatchEvaluation(Evaluation())
+    {
+    
+    }
+    
+    BatchEvaluation(const Evaluation& evaluation)
+        : _evaluation(evaluation)
+        , _kernel(supported(Kernel::Avx2) ? Kernel::Avx2 : supported(Kernel::Neon) ? Kernel::Neon : Kernel::Scalar)
+    {
+        for (auto color : {BitBoard::Color::White, BitBoard::Color::Black}) {
+            for (bool king : {false, true}) {
+                std::map<int32_t, uint64_t> squaresByValue;
+                for (int square = 0; square < BitBoard::kSquares; ++square) {
+                    squaresByValue[evaluation.squareValue(color, king, square)] |= BitBoard::mask(square);
+                }
+                
+                // Black pieces count against white, whose point of view the sum is taken from
+                auto& terms = _terms[static_cast<int>(color)][king];
+                for (auto&& [value, squares] : squaresByValue) {
+                    if (value != 0) {
+                        terms.push_back(Term{squares, color == BitBoard::Color::White ? value : -value});
+                    }
+                }
+            }
+        }
+        
+        for (int square = 0; square < BitBoard::kSquares; ++square) {
+            _valid |= BitBoard::mask(square);
+        }
+    }
+    
+    static bool supported(Kernel kernel)
+    {
+        switch (kernel) {
+        case Kernel::Scalar:
+            return true;
+        case Kernel::Avx2:
+#ifdef BATCH_EVALUATION_AVX2
+            return __builtin_cpu_supports("avx2");
+#else
+            return false;
+#endif
+        case Kernel::Neon:
+#ifdef BATCH_EVALUATION_NEON
+            return true;
+#else
+            return false;
+#endif
+        }
+        
+        return false;
+    }
+    
+    Kernel kernel() const
+    {
+        return _kernel;
+    }
+    
+    /**
+     * Forces a kernel, for comparing them against each other.
+     */
+    void setKernel(Kernel kernel)
+    {
+        if (!supported(kernel)) {
+            throw std::runtime_error("evaluation kernel not supported by this build or processor");
+        }
+        
+        _kernel = kernel;
+    }
+    
+    const Evaluation& evaluation() const
+    {
+        return _evaluation;
+    }
+    
+    /**
+     * Writes the evaluation of every position in the batch to `scores`, each from the point of view of the
+     * side to move in it.
+     */
+    void evaluate(const PositionBatch& batch, int32_t* scores) const
+    {
+        size_t done = 0;
+#ifdef BATCH_EVALUATION_AVX2
+        if (_kernel == Kernel::Avx2) {
+            done = evaluateAvx2(batch, scores);
+        }
+#endif
+#ifdef BATCH_EVALUATION_NEON
+        if (_kernel == Kernel::Neon) {
+            done = evaluateNeon(batch, scores);
+        }
+#endif
+        for (size_t i = done; i < batch.size(); ++i) {
+            scores[i] = evaluateScalar(batch, i);
+        }
+    }
+    
+    std::vector<int32_t> evaluate(const PositionBatch& batch) const
+    {
+        std::vector<int32_t> scores(batch.size());
+        evaluate(batch, scores.data());
+        return scores;
+    }
+
+private:
+    // Squares of the pieces in a group, all with the same value
+    struct Term
+    {
+        uint64_t squares;
+        int32_t value;
+    };
+    
+    // Bit distances of the single steps, towards the lower squares for the first two
+    static constexpr int kShort = BitBoard::kRowSquares;
+    static constexpr int kLong = BitBoard::kRowSquares + 1;
+
+private:
+    /**
+     * `Evaluation::evaluate` of one position of the batch.
+     */
+    int32_t evaluateScalar(const PositionBatch& batch, size_t index) const
+    {
+        // The evaluation doesn't look at the hash, so unlike `PositionBatch::board` this leaves it out
+        BitBoard board;
+        board.white = batch.white[index];
+        board.black = batch.black[index];
+        board.kings = batch.kings[index];
+        board.turn = batch.turn[index];
+        return _evaluation.evaluate(board);
+    }
+
+#ifdef BATCH_EVALUATION_AVX2
+    /**
+     * Bytes holding the amount of set bits in each byte of the lanes.
+     */
+    __attribute__((target("avx2"))) static __m256i byteCounts(__m256i bits)
+    {
+        const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                               0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        const __m256i nibble = _mm256_set1_epi8(0x0f);
+        __m256i low = _mm256_shuffle_epi8(table, _mm256_and_si256(bits, nibble));
+        __m256i high = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(bits, 4), nibble));
+        return _mm256_add_epi8(low, high);
+    }
+    
+    /**
+     * Sums the bytes of each 64 bit lane.
+     */
+    __attribute__((target("avx2"))) static __m256i laneSums(__m256i bytes)
+    {
+        return _mm256_sad_epu8(bytes, _mm256_setzero_si256());
+    }
+    
+    __attribute__((target("avx2"))) size_t evaluateAvx2(const PositionBatch& batch, int32_t* scores) const
+    {
+        const __m256i valid = _mm256_set1_epi64x(static_cast<long long>(_valid));
+        const __m256i mobility = _mm256_set1_epi64x(_evaluation.weights().mobility);
+        
+        size_t i = 0;
+        for (; i + 4 <= batch.size(); i += 4) {
+            __m256i white = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&batch.white[i]));
+            __m256i black = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&batch.black[i]));
+            __m256i kings = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&batch.kings[i]));
+            __m256i pieces[2][2] = {
+                {_mm256_andnot_si256(kings, white), _mm256_and_si256(white, kings)},
+                {_mm256_andnot_si256(kings, black), _mm256_and_si256(black, kings)}
+            };
+            
+            // Counts are below 64, so the low halves of the lanes multiply as 32 bit numbers
+            __m256i score = _mm256_setzero_si256();
+            for (int color = 0; color < 2; ++color) {
+                for (int king = 0; king < 2; ++king) {
+                    for (auto&& term : _terms[color][king]) {
+                        __m256i squares = _mm256_set1_epi64x(static_cast<long long>(term.squares));
+                        __m256i count = laneSums(byteCounts(_mm256_and_si256(pieces[color][king], squares)));
+                        score = _mm256_add_epi64(score, _mm256_mul_epi32(count, _mm256_set1_epi64x(term.value)));
+                    }
+                }
+            }
+            
+            // A byte counts at most eight steps per direction, so the four directions add up before summing
+            __m256i free = _mm256_andnot_si256(_mm256_or_si256(white, black), valid);
+            __m256i whiteSteps = _mm256_add_epi8(
+                _mm256_add_epi8(byteCounts(_mm256_and_si256(_mm256_srli_epi64(white, kShort), free)),
+                                byteCounts(_mm256_and_si256(_mm256_srli_epi64(white, kLong), free))),
+                _mm256_add_epi8(byteCounts(_mm256_and_si256(_mm256_slli_epi64(pieces[0][1], kShort), free)),
+                                byteCounts(_mm256_and_si256(_mm256_slli_epi64(pieces[0][1], kLong), free))));
+            __m256i blackSteps = _mm256_add_epi8(
+                _mm256_add_epi8(byteCounts(_mm256_and_si256(_mm256_slli_epi64(black, kShort), free)),
+                                byteCounts(_mm256_and_si256(_mm256_slli_epi64(black, kLong), free))),
+                _mm256_add_epi8(byteCounts(_mm256_and_si256(_mm256_srli_epi64(pieces[1][1], kShort), free)),
+                                byteCounts(_mm256_and_si256(_mm256_srli_epi64(pieces[1][1], kLong), free))));
+            __m256i steps = _mm256_sub_epi64(laneSums(whiteSteps), laneSums(blackSteps));
+            score = _mm256_add_epi64(score, _mm256_mul_epi32(steps, mobility));
+            
+            alignas(32) int64_t lanes[4];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), score);
+            for (size_t lane = 0; lane < 4; ++lane) {
+                int32_t value = static_cast<int32_t>(lanes[lane]);
+                scores[i + lane] = batch.turn[i + lane] == BitBoard::Color::White ? value : -value;
+            }
+        }
+        
+        return i;
+    }
+#endif
+
+#ifdef BATCH_EVALUATION_NEON
+    static int32x2_t laneCounts(uint64x2_t bits)
+    {
+        uint64x2_t counts = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(vcntq_u8(vreinterpretq_u8_u64(bits)))));
+        return vreinterpret_s32_u32(vmovn_u64(counts));
+    }
+    
+    size_t evaluateNeon(const PositionBatch& batch, int32_t* scores) const
+    {
+        const uint64x2_t valid = vdupq_n_u64(_valid);
+        
+        size_t i = 0;
+        for (; i + 2 <= batch.size(); i += 2) {
+            uint64x2_t white = vld1q_u64(&batch.white[i]);
+            uint64x2_t black = vld1q_u64(&batch.black[i]);
+            uint64x2_t kings = vld1q_u64(&batch.kings[i]);
+            uint64x2_t pieces[2][2] = {
+                {vbicq_u64(white, kings), vandq_u64(white, kings)},
+                {vbicq_u64(black, kings), vandq_u64(black, kings)}
+            };
+            
+            int32x2_t score = vdup_n_s32(0);
+            for (int color = 0; color < 2; ++color) {
+                for (int king = 0; king < 2; ++king) {
+                    for (auto&& term : _terms[color][king]) {
+                        int32x2_t count = laneCounts(vandq_u64(pieces[color][king], vdupq_n_u64(term.squares)));
+                        score = vmla_n_s32(score, count, term.value);
+                    }
+                }
+            }
+            
+            uint64x2_t free = vbicq_u64(valid, vorrq_u64(white, black));
+            int32x2_t whiteSteps = vadd_s32(
+                vadd_s32(laneCounts(vandq_u64(vshrq_n_u64(white, kShort), free)),
+                         laneCounts(vandq_u64(vshrq_n_u64(white, kLong), free))),
+                vadd_s32(laneCounts(vandq_u64(vshlq_n_u64(pieces[0][1], kShort), free)),
+                         laneCounts(vandq_u64(vshlq_n_u64(pieces[0][1], kLong), free))));
+            int32x2_t blackSteps = vadd_s32(
+                vadd_s32(laneCounts(vandq_u64(vshlq_n_u64(black, kShort), free)),
+                         laneCounts(vandq_u64(vshlq_n_u64(black, kLong), free))),
+                vadd_s32(laneCounts(vandq_u64(vshrq_n_u64(pieces[1][1], kShort), free)),
+                         laneCounts(vandq_u64(vshrq_n_u64(pieces[1][1], kLong), free))));
+            score = vmla_n_s32(score, vsub_s32(whiteSteps, blackSteps), _evaluation.weights().mobility);
+            
+            for (size_t lane = 0; lane < 2; ++lane) {
+                int32_t value = lane == 0 ? vget_lane_s32(score, 0) : vget_lane_s32(score, 1);
+                scores[i + lane] = batch.turn[i + lane] == BitBoard::Color::White ? value : -value;
+            }
+        }
+        
+        return i;
+    }
+#endif
+
+private:
+    Evaluation _evaluation;
+    Kernel _kernel;
+    
+    // Groups of squares per color and man or king
+    std::array<std::array<std::vector<Term>, 2>, 2> _terms;
+    uint64_t _valid{0};
+};
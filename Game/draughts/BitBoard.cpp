@@ -0,0 +1 @@
+#include "BitBoard.hpp"
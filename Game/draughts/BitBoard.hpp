@@ -0,0 +1,536 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+#include "Variant.hpp"
+#include "Zobrist.hpp"
+
+/**
+ * Types shared by the positions of all variants.
+ */
+class BitBoardBase
+{
+public:
+    enum class Color : uint8_t
+    {
+        White,
+        Black
+    };
+};
+
+/**
+ * Compact draughts position, for the variant described by `Variant`.
+ *
+ * The playable squares are numbered from 0 (official square number minus one), starting top left from
+ * white's point of view, so in international draughts black starts on 0-19 and white on 30-49. Internally
+ * every square maps to a bit with a ghost bit after every two rows, which makes all four diagonal
+ * neighbours a constant shift and lets pieces fall off the board into the ghost bits instead of wrapping
+ * around. On the 10x10 board the shifts are 5 and 6 bits, on the 8x8 board 4 and 5.
+ */
+template <typename Variant>
+class BasicBitBoard : public BitBoardBase
+{
+public:
+    static constexpr int kSize = Variant::kSize;
+    static constexpr int kRowSquares = kSize / 2;
+    static constexpr int kSquares = kSize * kRowSquares;
+    static constexpr int kBits = kSquares + kRowSquares - 1;
+    static constexpr int kStartSquares = Variant::kStartRows * kRowSquares;
+    
+    // A move can't capture more pieces than the opponent starts with
+    static constexpr int kMaxCaptures = kStartSquares;
+    
+    // Plies with only kings moving and nothing captured after which the game is drawn
+    static constexpr int kDrawPlies = 2 * Variant::kDrawMoves;
+    
+    static constexpr std::array<int, 4> kDirections{-kRowSquares - 1, -kRowSquares, kRowSquares, kRowSquares + 1};
+    
+    static_assert(kBits <= 64, "the board has to fit in 64 bits");
+    
+    struct Move
+    {
+        // Bit mask of the captured pieces, in the internal bit layout
+        uint64_t captured{0};
+        uint8_t from{0};
+        uint8_t to{0};
+        uint8_t captures{0};
+        
+        // Landing square of every capture hop, the last one equals `to`
+        std::array<uint8_t, kMaxCaptures> path{};
+        
+        bool operator ==(const Move& other) const
+        {
+            return from == other.from && to == other.to && captured == other.captured;
+        }
+        
+        bool operator !=(const Move& other) const
+        {
+            return !(*this == other);
+        }
+    };
+    
+    /**
+     * Fixed capacity list of moves, so generating the moves of a position never touches the heap.
+     */
+    class MoveList
+    {
+    public:
+        // Moves are indexed by a byte, which leaves the largest value free to mean no move
+        static constexpr size_t kCapacity = 255;
+    
+    public:
+        void add(const Move& move)
+        {
+            assert(_size < kCapacity);
+            _moves[_size++] = move;
+        }
+        
+        void clear()
+        {
+            _size = 0;
+        }
+        
+        size_t size() const
+        {
+            return _size;
+        }
+        
+        bool empty() const
+        {
+            return _size == 0;
+        }
+        
+        Move& operator [](size_t index)
+        {
+            return _moves[index];
+        }
+        
+        const Move& operator [](size_t index) const
+        {
+            return _moves[index];
+        }
+        
+        Move* begin()
+        {
+            return _moves.data();
+        }
+        
+        Move* end()
+        {
+            return _moves.data() + _size;
+        }
+        
+        const Move* begin() const
+        {
+            return _moves.data();
+        }
+        
+        const Move* end() const
+        {
+            return _moves.data() + _size;
+        }
+    
+    private:
+        std::array<Move, kCapacity> _moves;
+        size_t _size{0};
+    };
+
+public:
+    static constexpr int bit(int square)
+    {
+        return square + square / kSize;
+    }
+    
+    static constexpr int square(int bit)
+    {
+        return bit - bit / (kSize + 1);
+    }
+    
+    static constexpr uint64_t mask(int square)
+    {
+        return uint64_t{1} << bit(square);
+    }
+    
+    static int lowest(uint64_t bits)
+    {
+        return __builtin_ctzll(bits);
+    }
+    
+    static int popcount(uint64_t bits)
+    {
+        return __builtin_popcountll(bits);
+    }
+    
+    static BasicBitBoard initial()
+    {
+        BasicBitBoard board;
+        for (int square = 0; square < kStartSquares; ++square) {
+            board.set(square, Color::Black, false);
+            board.set(kSquares - 1 - square, Color::White, false);
+        }
+        
+        return board;
+    }
+    
+    void set(int square, Color color, bool king)
+    {
+        (color == Color::White ? white : black) |= mask(square);
+        if (king) {
+            kings |= mask(square);
+        }
+        
+        hash ^= Zobrist::piece(piece(color, king), bit(square));
+    }
+    
+    void setTurn(Color color)
+    {
+        if (color != turn) {
+            turn = color;
+            hash ^= Zobrist::side();
+        }
+    }
+    
+    /**
+     * Hash of the position computed from scratch, equal to the incrementally updated `hash`.
+     */
+    uint64_t computeHash() const
+    {
+        uint64_t computed = turn == Color::Black ? Zobrist::side() : 0;
+        for (uint64_t pieces = white | black; pieces; pieces &= pieces - 1) {
+            int at = lowest(pieces);
+            computed ^= Zobrist::piece(pieceAt(at), at);
+        }
+        
+        return computed;
+    }
+    
+    uint64_t own() const
+    {
+        return turn == Color::White ? white : black;
+    }
+    
+    uint64_t opponent() const
+    {
+        return turn == Color::White ? black : white;
+    }
+    
+    uint64_t empty() const
+    {
+        return kValid & ~(white | black);
+    }
+    
+    /**
+     * Writes all legal moves for the side to move into `moves`. Captures are mandatory and, in variants
+     * with the maximum capture rule, only the ones capturing the maximum amount of pieces are legal, which
+     * is enforced while generating so shorter capture sequences are never stored. Captured pieces stay on
+     * the board until the move is finished, so they can neither be jumped twice nor passed by a king.
+     */
+    void generate(MoveList& moves) const
+    {
+        moves.clear();
+        
+        uint64_t pieces = own();
+        while (pieces) {
+            int from = lowest(pieces);
+            pieces &= pieces - 1;
+            
+            Move move;
+            move.from = static_cast<uint8_t>(square(from));
+            uint64_t occupied = (white | black) & ~(uint64_t{1} << from);
+            if (kings & (uint64_t{1} << from)) {
+                findKingCaptures(moves, move, from, occupied);
+            } else {
+                findManCaptures(moves, move, from, occupied);
+            }
+        }
+        
+        if (!moves.empty()) {
+            return;
+        }
+        
+        uint64_t free = empty();
+        uint64_t men = own() & ~kings;
+        for (int direction : forward()) {
+            uint64_t targets = shift(men, direction) & free;
+            while (targets) {
+                int to = lowest(targets);
+                targets &= targets - 1;
+                moves.add(quietMove(to - direction, to));
+            }
+        }
+        
+        uint64_t ladies = own() & kings;
+        while (ladies) {
+            int from = lowest(ladies);
+            ladies &= ladies - 1;
+            
+            for (int direction : kDirections) {
+                uint64_t target = shift(uint64_t{1} << from, direction) & free;
+                while (target) {
+                    moves.add(quietMove(from, lowest(target)));
+                    target = Variant::kFlyingKings ? shift(target, direction) & free : 0;
+                }
+            }
+        }
+    }
+    
+    /**
+     * What `make` can't recompute when taking a move back: the kings before promotion and captures, and
+     * the hash.
+     */
+    struct Undo
+    {
+        uint64_t kings;
+        uint64_t hash;
+    };
+    
+    /**
+     * Returns the position after the move, promoting a man that ends its move on the opposite back row.
+     */
+    BasicBitBoard apply(const Move& move) const
+    {
+        BasicBitBoard next = *this;
+        Undo undo;
+        next.make(move, undo);
+        return next;
+    }
+    
+    /**
+     * Plays the move on this position, touching only the squares it changes. `unmake` with the same move
+     * and undo information restores the position.
+     */
+    void make(const Move& move, Undo& undo)
+    {
+        undo = Undo{kings, hash};
+        uint64_t from = mask(move.from);
+        uint64_t to = mask(move.to);
+        
+        // Only the changed squares are rehashed
+        hash ^= Zobrist::piece(pieceAt(lowest(from)), lowest(from));
+        for (uint64_t captured = move.captured; captured; captured &= captured - 1) {
+            int at = lowest(captured);
+            hash ^= Zobrist::piece(pieceAt(at), at);
+        }
+        
+        uint64_t& own = turn == Color::White ? white : black;
+        uint64_t& opponent = turn == Color::White ? black : white;
+        own = (own & ~from) | to;
+        opponent &= ~move.captured;
+        
+        if (kings & from) {
+            kings = (kings & ~from) | to;
+        } else if ((to & promotionRow()) || promotedDuringCapture(move)) {
+            kings |= to;
+        }
+        kings &= ~move.captured;
+        
+        hash ^= Zobrist::piece(pieceAt(lowest(to)), lowest(to));
+        turn = turn == Color::White ? Color::Black : Color::White;
+        hash ^= Zobrist::side();
+    }
+    
+    void unmake(const Move& move, const Undo& undo)
+    {
+        turn = turn == Color::White ? Color::Black : Color::White;
+        
+        uint64_t& own = turn == Color::White ? white : black;
+        uint64_t& opponent = turn == Color::White ? black : white;
+        own = (own & ~mask(move.to)) | mask(move.from);
+        opponent |= move.captured;
+        kings = undo.kings;
+        hash = undo.hash;
+    }
+    
+    int count(Color color) const
+    {
+        return popcount(color == Color::White ? white : black);
+    }
+    
+    /**
+     * Amount of single steps the pieces of `color` can make to an empty square, a cheap measure of
+     * mobility that ignores captures and the longer moves of kings.
+     */
+    int mobility(Color color) const
+    {
+        uint64_t pieces = color == Color::White ? white : black;
+        uint64_t free = empty();
+        
+        int steps = 0;
+        for (size_t i = 0; i < kDirections.size(); ++i) {
+            // White men step towards the lower squares, black men towards the higher ones, kings both ways
+            bool forward = (kDirections[i] < 0) == (color == Color::White);
+            steps += popcount(shift(forward ? pieces : pieces & kings, kDirections[i]) & free);
+        }
+        
+        return steps;
+    }
+
+public:
+    uint64_t white{0};
+    uint64_t black{0};
+    uint64_t kings{0};
+    Color turn{Color::White};
+    uint64_t hash{0};
+
+private:
+    static constexpr uint64_t kValid = [] {
+        uint64_t valid = 0;
+        for (int square = 0; square < kSquares; ++square) {
+            valid |= uint64_t{1} << (square + square / kSize);
+        }
+        
+        return valid;
+    }();
+    static constexpr uint64_t kTopRow = (uint64_t{1} << kRowSquares) - 1;
+    static constexpr uint64_t kBottomRow = kTopRow << (kBits - kRowSquares);
+    
+    static uint64_t shift(uint64_t bits, int direction)
+    {
+        return (direction > 0 ? bits << direction : bits >> -direction) & kValid;
+    }
+    
+    static Zobrist::Piece piece(Color color, bool king)
+    {
+        return static_cast<Zobrist::Piece>(static_cast<int>(color) + (king ? 2 : 0));
+    }
+    
+    Zobrist::Piece pieceAt(int at) const
+    {
+        uint64_t atMask = uint64_t{1} << at;
+        return piece(white & atMask ? Color::White : Color::Black, kings & atMask);
+    }
+    
+    static Move quietMove(int from, int to)
+    {
+        Move move;
+        move.from = static_cast<uint8_t>(square(from));
+        move.to = static_cast<uint8_t>(square(to));
+        return move;
+    }
+    
+    std::array<int, 2> forward() const
+    {
+        return turn == Color::White ? std::array<int, 2>{kDirections[0], kDirections[1]}
+                                    : std::array<int, 2>{kDirections[2], kDirections[3]};
+    }
+    
+    uint64_t promotionRow() const
+    {
+        return turn == Color::White ? kTopRow : kBottomRow;
+    }
+    
+    bool promotedDuringCapture(const Move& move) const
+    {
+        if constexpr (Variant::kPromoteDuringCapture) {
+            for (int hop = 0; hop < move.captures; ++hop) {
+                if (mask(move.path[hop]) & promotionRow()) {
+                    return true;
+                }
+            }
+        }
+        
+        return false;
+    }
+    
+    void findManCaptures(MoveList& moves, Move& move, int at, uint64_t occupied) const
+    {
+        uint64_t capturable = opponent() & ~move.captured;
+        uint64_t free = kValid & ~occupied;
+        bool continued = false;
+        
+        for (int direction : kDirections) {
+            // White men move towards the lower squares, black men towards the higher ones
+            if (!Variant::kMenCaptureBackward && (direction < 0) != (turn == Color::White)) {
+                continue;
+            }
+            
+            uint64_t victim = shift(uint64_t{1} << at, direction) & capturable;
+            uint64_t landing = shift(victim, direction) & free;
+            if (!landing) {
+                continue;
+            }
+            
+            continued = true;
+            bool promoted = Variant::kPromoteDuringCapture && (landing & promotionRow());
+            recordHop(moves, move, victim, lowest(landing), occupied, promoted);
+        }
+        
+        if (!continued && move.captures > 0) {
+            addCapture(moves, move);
+        }
+    }
+    
+    void findKingCaptures(MoveList& moves, Move& move, int at, uint64_t occupied) const
+    {
+        uint64_t capturable = opponent() & ~move.captured;
+        uint64_t free = kValid & ~occupied;
+        bool continued = false;
+        
+        for (int direction : kDirections) {
+            uint64_t victim = shift(uint64_t{1} << at, direction);
+            while (Variant::kFlyingKings && (victim & free)) {
+                victim = shift(victim, direction);
+            }
+            
+            victim &= capturable;
+            uint64_t landing = shift(victim, direction) & free;
+            while (landing) {
+                continued = true;
+                recordHop(moves, move, victim, lowest(landing), occupied, true);
+                landing = Variant::kFlyingKings ? shift(landing, direction) & free : 0;
+            }
+        }
+        
+        if (!continued && move.captures > 0) {
+            addCapture(moves, move);
+        }
+    }
+    
+    static void addCapture(MoveList& moves, Move& move)
+    {
+        if constexpr (Variant::kMaximumCapture) {
+            // Any stored capture has the maximum amount found so far, drop shorter ones and replace by longer ones
+            if (!moves.empty() && moves[0].captures > move.captures) {
+                return;
+            }
+            if (!moves.empty() && moves[0].captures < move.captures) {
+                moves.clear();
+            }
+        }
+        move.to = move.path[move.captures - 1];
+        
+        // Different routes capturing the same pieces count as one move
+        for (const auto& possibleMove : moves) {
+            if (possibleMove == move) {
+                return;
+            }
+        }
+        
+        moves.add(move);
+    }
+    
+    void recordHop(MoveList& moves, Move& move, uint64_t victim, int landing, uint64_t occupied, bool king) const
+    {
+        move.path[move.captures++] = static_cast<uint8_t>(square(landing));
+        move.captured |= victim;
+        
+        if (king) {
+            findKingCaptures(moves, move, landing, occupied);
+        } else {
+            findManCaptures(moves, move, landing, occupied);
+        }
+        
+        move.captured &= ~victim;
+        move.captures--;
+    }
+};
+
+inline BitBoardBase::Color operator !(BitBoardBase::Color color)
+{
+    return color == BitBoardBase::Color::White ? BitBoardBase::Color::Black : BitBoardBase::Color::White;
+}
+
+using BitBoard = BasicBitBoard<International>;
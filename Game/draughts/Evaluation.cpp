@@ -0,0 +1 @@
+#include "Evaluation.hpp"
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "BitBoard.hpp"
+
+/**
+ * Static evaluation of a position in centipieces, a man being worth about 100.
+ *
+ * Everything except mobility only depends on which piece stands on which square, so it is folded into one
+ * table per piece and square. A move then changes the evaluation by the table entries of the squares it
+ * touches, which the search accumulates from ply to ply instead of scanning the whole board at every leaf.
+ */
+class Evaluation
+{
+public:
+    struct Weights
+    {
+        int32_t man{100};
+        int32_t king{300};
+        
+        // Bonus for a man by the amount of rows it advanced, on top of the linear tempo bonus
+        std::array<int32_t, BitBoard::kSize> advancement{};
+        int32_t tempo{2};
+        
+        // Bonus for every piece on one of the six central squares
+        int32_t center{5};
+        
+        // Bonus for every man still guarding its own back row against promotions
+        int32_t backRank{8};
+        
+        // Bonus for every single step the pieces can make
+        int32_t mobility{2};
+    };
+
+public:
+    Evaluation()
+        : Evaluation(Weights())
+    {
+    
+    }
+    
+    Evaluation(const Weights& weights)
+        : _weights(weights)
+    {
+        for (int square = 0; square < BitBoard::kSquares; ++square) {
+            for (auto color : {BitBoard::Color::White, BitBoard::Color::Black}) {
+                int row = square / BitBoard::kRowSquares;
+                int advanced = color == BitBoard::Color::White ? BitBoard::kSize - 1 - row : row;
+                int32_t center = kCenter & BitBoard::mask(square) ? weights.center : 0;
+                
+                _squares[0][static_cast<int>(color)][square] = weights.man + weights.advancement[advanced] + weights.tempo * advanced
+                                                             + center + (advanced == 0 ? weights.backRank : 0);
+                _squares[1][static_cast<int>(color)][square] = weights.king + center;
+            }
+        }
+    }
+    
+    /**
+     * Reads weights from a text file with one weight per line, its name followed by its value, or ten values
+     * for the advancement. Weights missing from the file keep their default value, lines starting with a #
+     * are comments.
+     */
+    static Weights load(const std::string& path)
+    {
+        std::ifstream file(path);
+        if (!file) {
+            throw std::runtime_error("can't read weights file " + path);
+        }
+        
+        Weights weights;
+        std::string line;
+        while (std::getline(file, line)) {
+            std::stringstream stream(line);
+            std::string name;
+            if (!(stream >> name) || name[0] == '#') {
+                continue;
+            }
+            
+            bool valid = true;
+            if (name == "advancement") {
+                for (auto&& advancement : weights.advancement) {
+                    valid &= static_cast<bool>(stream >> advancement);
+                }
+            } else if (int32_t* weight = find(weights, name)) {
+                valid = static_cast<bool>(stream >> *weight);
+            } else {
+                throw std::runtime_error("unknown weight " + name + " in " + path);
+            }
+            
+            if (!valid) {
+                throw std::runtime_error("invalid value for weight " + name + " in " + path);
+            }
+        }
+        
+        return weights;
+    }
+    
+    /**
+     * Writes weights in the format `load` reads.
+     */
+    static void save(const std::string& path, Weights weights)
+    {
+        std::ofstream file(path);
+        for (auto&& name : {"man", "king", "tempo", "center", "backRank", "mobility"}) {
+            file << name << " " << *find(weights, name) << std::endl;
+        }
+        
+        file << "advancement";
+        for (auto&& advancement : weights.advancement) {
+            file << " " << advancement;
+        }
+        file << std::endl;
+        
+        if (!file) {
+            throw std::runtime_error("can't write weights file " + path);
+        }
+    }
+    
+    const Weights& weights() const
+    {
+        return _weights;
+    }
+    
+    /**
+     * Value of a man or king of `color` on `square`, including its material.
+     */
+    int32_t squareValue(BitBoard::Color color, bool king, int square) const
+    {
+        return _squares[king][static_cast<int>(color)][square];
+    }
+    
+    /**
+     * Sum of the square tables from white's point of view, computed from scratch.
+     */
+    int32_t accumulate(const BitBoard& board) const
+    {
+        int32_t score = 0;
+        for (uint64_t pieces = board.white | board.black; pieces; pieces &= pieces - 1) {
+            int at = BitBoard::lowest(pieces);
+            auto color = board.white & (uint64_t{1} << at) ? BitBoard::Color::White : BitBoard::Color::Black;
+            int32_t value = squareValue(color, board.kings & (uint64_t{1} << at), BitBoard::square(at));
+            score += color == BitBoard::Color::White ? value : -value;
+        }
+        
+        return score;
+    }
+    
+    /**
+     * Change of the accumulated score by `move`, which was just made on `board` by `BitBoard::make` and
+     * left `undo` behind. Only the squares the move touches are looked at.
+     */
+    int32_t update(const BitBoard& board, const BitBoard::Undo& undo, const BitBoard::Move& move) const
+    {
+        auto color = !board.turn;
+        int32_t delta = squareValue(color, board.kings & BitBoard::mask(move.to), move.to)
+                      - squareValue(color, undo.kings & BitBoard::mask(move.from), move.from);
+        
+        for (uint64_t captured = move.captured; captured; captured &= captured - 1) {
+            int at = BitBoard::lowest(captured);
+            delta += squareValue(!color, undo.kings & (uint64_t{1} << at), BitBoard::square(at));
+        }
+        
+        return color == BitBoard::Color::White ? delta : -delta;
+    }
+    
+    /**
+     * Evaluation from the point of view of the side to move, given the accumulated score of the position.
+     */
+    int32_t evaluate(const BitBoard& board, int32_t accumulated) const
+    {
+        assert(accumulated == accumulate(board));
+        
+        int32_t score = accumulated + _weights.mobility * (board.mobility(BitBoard::Color::White) - board.mobility(BitBoard::Color::Black));
+        return board.turn == BitBoard::Color::White ? score : -score;
+    }
+    
+    int32_t evaluate(const BitBoard& board) const
+    {
+        return evaluate(board, accumulate(board));
+    }
+
+private:
+    // Squares 22-24 and 27-29
+    static constexpr uint64_t kCenter = BitBoard::mask(21) | BitBoard::mask(22) | BitBoard::mask(23)
+                                      | BitBoard::mask(26) | BitBoard::mask(27) | BitBoard::mask(28);
+    
+    static int32_t* find(Weights& weights, const std::string& name)
+    {
+        std::pair<const char*, int32_t*> weightsByName[] = {
+            {"man", &weights.man},
+            {"king", &weights.king},
+            {"tempo", &weights.tempo},
+            {"center", &weights.center},
+            {"backRank", &weights.backRank},
+            {"mobility", &weights.mobility}
+        };
+        
+        for (auto&& [weightName, weight] : weightsByName) {
+            if (name == weightName) {
+                return weight;
+            }
+        }
+        
+        return nullptr;
+    }
+
+private:
+    Weights _weights;
+    
+    // Value of a man or king of either color on every square, including its material
+    std::array<std::array<std::array<int32_t, BitBoard::kSquares>, 2>, 2> _squares;
+};
@@ -0,0 +1 @@
+#include "EvaluationTuner.hpp"
@@ -0,0 +1,252 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "BatchEvaluation.hpp"
+#include "BitBoard.hpp"
+#include "Evaluation.hpp"
+
+/**
+ * Fits the evaluation weights to the outcomes of games, Texel style. The evaluation of a position is mapped
+ * to an expected outcome by a logistic curve, and the weights are changed one at a time for as long as that
+ * lowers the mean squared error against the outcomes actually reached.
+ *
+ * Positions are kept packed as bitboards, split into one slice per thread. Every thread scores its slice
+ * with a `BatchEvaluation`, so each try of a weight rescores all positions with vector instructions.
+ */
+class EvaluationTuner
+{
+public:
+    struct Options
+    {
+        size_t threads{std::max(1u, std::thread::hardware_concurrency())};
+        
+        // First amount a weight is changed by, halved whenever a pass over all weights changed nothing
+        int32_t step{8};
+        
+        // Passes over all weights at most
+        int passes{100};
+    };
+    
+    struct Progress
+    {
+        int pass;
+        int32_t step;
+        double error;
+        
+        // Best weights so far
+        Evaluation::Weights weights;
+    };
+
+public:
+    EvaluationTuner()
+        : EvaluationTuner(Options())
+    {
+    
+    }
+    
+    EvaluationTuner(const Options& options)
+        : _options(options)
+        , _slices(std::max<size_t>(options.threads, 1))
+    {
+    
+    }
+    
+    /**
+     * Whether neither side has a capture in the position. The evaluation doesn't see captures coming, so
+     * only these positions say anything about its weights.
+     */
+    static bool quiet(const BitBoard& board)
+    {
+        BitBoard::MoveList moves;
+        for (auto turn : {board.turn, !board.turn}) {
+            BitBoard position = board;
+            position.setTurn(turn);
+            position.generate(moves);
+            if (!moves.empty() && moves[0].captures > 0) {
+                return false;
+            }
+        }
+        
+        return true;
+    }
+    
+    /**
+     * Adds a position with the outcome of its game for the side to move, 1 for a win, 0 for a draw and -1
+     * for a loss.
+     */
+    void add(const BitBoard& board, int result)
+    {
+        Slice& slice = _slices[_size++ % _slices.size()];
+        slice.positions.add(board);
+        slice.results.push_back(static_cast<int8_t>(std::clamp(result, -1, 1)));
+        slice.scores.push_back(0);
+    }
+    
+    size_t size() const
+    {
+        return _size;
+    }
+    
+    /**
+     * Mean squared error of the weights with the curve's scale fixed.
+     */
+    double error(const Evaluation::Weights& weights, double scale)
+    {
+        evaluate(weights);
+        return error(scale);
+    }
+    
+    /**
+     * Scale of the logistic curve that fits the outcomes best with the given weights, found by a ternary
+     * search on its logarithm. The scale only says how sure a score is of the outcome, so it is fitted once
+     * before tuning and then kept.
+     */
+    double fitScale(const Evaluation::Weights& weights)
+    {
+        evaluate(weights);
+        
+        double low = std::log(1e-4);
+        double high = std::log(1e-1);
+        for (int i = 0; i < 50; ++i) {
+            double first = low + (high - low) / 3;
+            double second = high - (high - low) / 3;
+            if (error(std::exp(first)) < error(std::exp(second))) {
+                high = second;
+            } else {
+                low = first;
+            }
+        }
+        
+        return std::exp((low + high) / 2);
+    }
+    
+    /**
+     * Changes every weight but the value of a man, which sets the unit of the scores, by the step in
+     * whichever direction lowers the error, until no change does at the smallest step. `onPass` is called
+     * after every pass over all weights.
+     */
+    Evaluation::Weights tune(Evaluation::Weights weights, double scale, std::function<void(const Progress&)> onPass = {})
+    {
+        std::vector<int32_t*> parameters = {&weights.king, &weights.tempo, &weights.center, &weights.backRank, &weights.mobility};
+        
+        // A man on the last row is promoted, so the last advancement is never used
+        for (int row = 0; row < BitBoard::kSize - 1; ++row) {
+            parameters.push_back(&weights.advancement[row]);
+        }
+        
+        double best = error(weights, scale);
+        int32_t step = std::max(_options.step, 1);
+        for (int pass = 1; pass <= _options.passes; ++pass) {
+            bool improved = false;
+            for (int32_t* parameter : parameters) {
+                for (int32_t change : {step, -step}) {
+                    *parameter += change;
+                    double changed = error(weights, scale);
+                    if (changed < best) {
+                        best = changed;
+                        improved = true;
+                        break;
+                    }
+                    *parameter -= change;
+                }
+            }
+            
+            if (onPass) {
+                onPass(Progress{pass, step, best, weights});
+            }
+            
+            if (!improved) {
+                if (step == 1) {
+                    break;
+                }
+                step /= 2;
+            }
+        }
+        
+        return weights;
+    }
+
+private:
+    struct Slice
+    {
+        PositionBatch positions;
+        std::vector<int8_t> results;
+        std::vector<int32_t> scores;
+    };
+    
+    // Scores beyond this many centipieces count as this many, the curve is flat long before
+    static constexpr int32_t kScoreRange = 10000;
+
+private:
+    /**
+     * Runs `function` for every slice, on a thread of its own.
+     */
+    void parallel(const std::function<void(Slice&, size_t)>& function)
+    {
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < _slices.size(); ++i) {
+            threads.emplace_back([&, i]() {
+                function(_slices[i], i);
+            });
+        }
+        
+        for (auto&& thread : threads) {
+            thread.join();
+        }
+    }
+    
+    /**
+     * Scores all positions with the weights.
+     */
+    void evaluate(const Evaluation::Weights& weights)
+    {
+        BatchEvaluation evaluation{Evaluation(weights)};
+        parallel([&](Slice& slice, size_t) {
+            evaluation.evaluate(slice.positions, slice.scores.data());
+        });
+    }
+    
+    /**
+     * Mean squared error of the last scores. The error of every score and outcome is looked up in a table,
+     * as the scores take far fewer values than there are positions.
+     */
+    double error(double scale)
+    {
+        std::vector<double> table[3];
+        for (int result = 0; result < 3; ++result) {
+            double target = result / 2.0;
+            table[result].resize(2 * kScoreRange + 1);
+            for (int32_t score = -kScoreRange; score <= kScoreRange; ++score) {
+                double expected = 1 / (1 + std::exp(-scale * score));
+                table[result][score + kScoreRange] = (target - expected) * (target - expected);
+            }
+        }
+        
+        std::vector<double> sums(_slices.size());
+        parallel([&](Slice& slice, size_t index) {
+            double sum = 0;
+            for (size_t i = 0; i < slice.scores.size(); ++i) {
+                sum += table[slice.results[i] + 1][std::clamp(slice.scores[i], -kScoreRange, kScoreRange) + kScoreRange];
+            }
+            sums[index] = sum;
+        });
+        
+        double sum = 0;
+        for (double partial : sums) {
+            sum += partial;
+        }
+        
+        return _size > 0 ? sum / _size : 0;
+    }
+
+private:
+    Options _options;
+    std::vector<Slice> _slices;
+    size_t _size{0};
+};
@@ -0,0 +1 @@
+#include "GameState.hpp"
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include "BitBoard.hpp"
+#include "HashHistory.hpp"
+
+/**
+ * The rules side of a game of draughts: the position, whose turn it is, the moves played so far, the
+ * captures of both sides and the outcome. Knows nothing about rendering, so it can be played headless.
+ *
+ * A game is drawn when a position occurs for the third time with the same side to move, or when both
+ * sides only moved kings without capturing for `BitBoard::kDrawPlies` plies.
+ */
+class GameState
+{
+public:
+    enum class Result
+    {
+        Ongoing,
+        WhiteWins,
+        BlackWins,
+        Draw
+    };
+
+public:
+    GameState(const BitBoard& board = BitBoard::initial())
+        : _board(board)
+        , _positions(board)
+    {
+        _board.generate(_legalMoves);
+    }
+    
+    const BitBoard& board() const
+    {
+        return _board;
+    }
+    
+    BitBoard::Color turn() const
+    {
+        return _board.turn;
+    }
+    
+    const BitBoard::MoveList& legalMoves() const
+    {
+        return _legalMoves;
+    }
+    
+    /**
+     * Plays the move if it is legal. A man ending on the opposite back row is promoted to king.
+     */
+    bool play(const BitBoard::Move& move)
+    {
+        if (result() != Result::Ongoing || std::find(_legalMoves.begin(), _legalMoves.end(), move) == _legalMoves.end()) {
+            return false;
+        }
+        
+        _captured[static_cast<int>(!_board.turn)] += move.captures;
+        _promoted = !(_board.kings & BitBoard::mask(move.from));
+        bool irreversible = HashHistory::irreversible(_board, move);
+        
+        _board = _board.apply(move);
+        _promoted &= (_board.kings & BitBoard::mask(move.to)) != 0;
+        _positions.push(_board.hash, irreversible);
+        
+        _history.emplace_back(move);
+        _board.generate(_legalMoves);
+        return true;
+    }
+    
+    /**
+     * A side that can't move anymore, because it has no pieces left or all of them are blocked, loses.
+     */
+    Result result() const
+    {
+        if (_legalMoves.empty()) {
+            return _board.turn == BitBoard::Color::White ? Result::BlackWins : Result::WhiteWins;
+        }
+        
+        if (_positions.repetitions() >= 2 || _positions.reversible() >= BitBoard::kDrawPlies) {
+            return Result::Draw;
+        }
+        
+        return Result::Ongoing;
+    }
+    
+    const std::vector<BitBoard::Move>& history() const
+    {
+        return _history;
+    }
+    
+    /**
+     * Hashes of the positions played, for the search to recognize repetitions of them.
+     */
+    const HashHistory& positions() const
+    {
+        return _positions;
+    }
+    
+    /**
+     * Amount of pieces of the given color that were captured so far.
+     */
+    int captured(BitBoard::Color color) const
+    {
+        return _captured[static_cast<int>(color)];
+    }
+    
+    /**
+     * Whether the last move promoted a man to king.
+     */
+    bool promoted() const
+    {
+        return _promoted;
+    }
+
+private:
+    BitBoard _board;
+    BitBoard::MoveList _legalMoves;
+    std::vector<BitBoard::Move> _history;
+    HashHistory _positions;
+    std::array<int, 2> _captured{0, 0};
+    bool _promoted{false};
+};
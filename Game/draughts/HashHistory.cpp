@@ -0,0 +1 @@
+#include "HashHistory.hpp"
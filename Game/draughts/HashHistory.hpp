@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "BitBoard.hpp"
+
+/**
+ * Hashes of the positions of a game, for recognizing repetitions. Men never move backward and captured
+ * pieces never come back, so a position can only repeat while kings move without capturing, and only the
+ * positions since the last other move are ever compared.
+ *
+ * The hashes are kept in a ring buffer of fixed size, so copying a history or adding to it never
+ * allocates. The draw rule ends a game long before the buffer fills, even with a search on top of the
+ * game. Positions that did fall out of the buffer are just no longer recognized.
+ */
+class HashHistory
+{
+public:
+    static constexpr size_t kCapacity = 256;
+    
+    static_assert((kCapacity & (kCapacity - 1)) == 0, "the capacity has to be a power of two");
+
+public:
+    HashHistory(const BitBoard& board = BitBoard::initial())
+    {
+        _entries[0] = Entry{board.hash, 0};
+    }
+    
+    /**
+     * Whether a move can never be taken back, because it moves a man or captures. `board` is the position
+     * before the move.
+     */
+    static bool irreversible(const BitBoard& board, const BitBoard::Move& move)
+    {
+        return move.captures > 0 || !(board.kings & BitBoard::mask(move.from));
+    }
+    
+    /**
+     * Adds the position after a move.
+     */
+    void push(uint64_t hash, bool irreversible)
+    {
+        int reversible = irreversible ? 0 : back().reversible + 1;
+        _entries[_size++ & kMask] = Entry{hash, reversible};
+    }
+    
+    /**
+     * Takes back the last position added, for a search taking back its moves.
+     */
+    void pop()
+    {
+        --_size;
+    }
+    
+    uint64_t hash() const
+    {
+        return back().hash;
+    }
+    
+    /**
+     * Plies played since the last move that can't be taken back.
+     */
+    int reversible() const
+    {
+        return back().reversible;
+    }
+    
+    /**
+     * How often the last position occurred before.
+     */
+    int repetitions() const
+    {
+        int count = 0;
+        for (int ply = kFirstRepetition; ply <= lookBack(); ply += 2) {
+            count += _entries[(_size - 1 - ply) & kMask].hash == back().hash;
+        }
+        
+        return count;
+    }
+    
+    /**
+     * Whether the last position occurred before, stopping at the first repetition.
+     */
+    bool repeated() const
+    {
+        for (int ply = kFirstRepetition; ply <= lookBack(); ply += 2) {
+            if (_entries[(_size - 1 - ply) & kMask].hash == back().hash) {
+                return true;
+            }
+        }
+        
+        return false;
+    }
+
+private:
+    struct Entry
+    {
+        uint64_t hash;
+        int reversible;
+    };
+    
+    static constexpr size_t kMask = kCapacity - 1;
+    
+    // The same side has to be to move, and both sides have to move a king away and back again
+    static constexpr int kFirstRepetition = 4;
+
+private:
+    const Entry& back() const
+    {
+        return _entries[(_size - 1) & kMask];
+    }
+    
+    int lookBack() const
+    {
+        return std::min(back().reversible, static_cast<int>(kCapacity) - 1);
+    }
+
+private:
+    std::array<Entry, kCapacity> _entries{};
+    
+    // Positions added since the start, the last one is the current position
+    size_t _size{1};
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Read-only memory mapping of a whole file. Pages are only read from disk when they are touched, and are
+ * shared between all processes mapping the same file.
+ */
+class MappedFile
+{
+public:
+    MappedFile(const std::string& path)
+    {
+        int file = open(path.c_str(), O_RDONLY);
+        if (file < 0) {
+            throw std::runtime_error("can't open " + path);
+        }
+        
+        struct stat status;
+        if (fstat(file, &status) != 0) {
+            close(file);
+            throw std::runtime_error("can't read " + path);
+        }
+        
+        _size = static_cast<size_t>(status.st_size);
+        void* mapping = _size > 0 ? mmap(nullptr, _size, PROT_READ, MAP_SHARED, file, 0) : nullptr;
+        close(file);
+        if (mapping == MAP_FAILED) {
+            throw std::runtime_error("can't map " + path);
+        }
+        
+        _data = static_cast<const uint8_t*>(mapping);
+    }
+    
+    MappedFile(MappedFile&& other)
+        : _data(std::exchange(other._data, nullptr))
+        , _size(std::exchange(other._size, 0))
+    {
+    
+    }
+    
+    MappedFile& operator =(MappedFile&& other)
+    {
+        std::swap(_data, other._data);
+        std::swap(_size, other._size);
+        return *this;
+    }
+    
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator =(const MappedFile&) = delete;
+    
+    ~MappedFile()
+    {
+        if (_data) {
+            munmap(const_cast<uint8_t*>(_data), _size);
+        }
+    }
+    
+    const uint8_t* data() const
+    {
+        return _data;
+    }
+    
+    size_t size() const
+    {
+        return _size;
+    }
+
+private:
+    const uint8_t* _data{nullptr};
+    size_t _size{0};
+};
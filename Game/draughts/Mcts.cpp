@@ -0,0 +1 @@
+#include "Mcts.hpp"
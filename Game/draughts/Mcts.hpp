@@ -0,0 +1,489 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "BatchEvaluation.hpp"
+#include "BitBoard.hpp"
+#include "Evaluation.hpp"
+#include "HashHistory.hpp"
+#include "Search.hpp"
+
+/**
+ * Monte Carlo tree search, an alternative to the alpha-beta search. Every iteration walks down the tree
+ * picking children by UCT, adds the children of the leaf it reaches, plays a simulated game from there and
+ * adds its result to every node on the way back. A node repeating a position of the game or of its path,
+ * or reached after too many plies without a capture or a man moving, is a draw and is never expanded.
+ *
+ * Threads share one tree. A thread passing a node counts its visit right away but its result only at the
+ * end of the iteration, so until then the visit counts as a loss, the virtual loss, and the next threads
+ * spread out over other children instead of all following the same path. Nodes come from a pool allocated
+ * up front, the tree stops growing once it is used up. The helper threads live as long as the search and
+ * are woken for every run by bumping a generation counter.
+ */
+class Mcts
+{
+public:
+    /**
+     * Picks the index of the move to play in a simulated game.
+     */
+    using RolloutPolicy = std::function<size_t(const BitBoard&, const BitBoard::MoveList&, std::mt19937_64&)>;
+    
+    struct Options
+    {
+        size_t threads{std::max(1u, std::thread::hardware_concurrency())};
+        
+        // Exploration constant of UCT, higher values try moves that did badly so far more often
+        double exploration{1.4};
+        
+        // Simulated games that last longer are decided by the evaluation
+        int rolloutPlies{40};
+        
+        // Visits a thread adds to every node on its path until it knows the result of its iteration
+        uint32_t virtualLoss{1};
+        
+        // Nodes allocated up front, at least enough for the root and all its children
+        size_t poolNodes{1 << 20};
+        
+        uint64_t seed{1};
+        RolloutPolicy policy{randomPolicy};
+    };
+
+public:
+    Mcts()
+        : Mcts(Options())
+    {
+    
+    }
+    
+    Mcts(const Options& options)
+        : _options(options)
+        , _capacity(options.poolNodes)
+    {
+        if (_capacity < 1 + BitBoard::MoveList::kCapacity) {
+            throw std::runtime_error("the node pool has to hold at least the root and all its moves");
+        }
+        
+        _nodes = std::make_unique<Node[]>(_capacity);
+        for (size_t i = 1; i < _options.threads; ++i) {
+            _helpers.emplace_back([this, i]() {
+                help(i);
+            });
+        }
+    }
+    
+    ~Mcts()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _quit = true;
+        }
+        _condition.notify_all();
+        for (auto&& helper : _helpers) {
+            helper.join();
+        }
+    }
+    
+    void setEvaluation(const Evaluation& evaluation)
+    {
+        _evaluation = evaluation;
+    }
+    
+    Search::Result run(const BitBoard& board, const Search::Limits& limits)
+    {
+        return run(board, HashHistory(board), limits);
+    }
+    
+    /**
+     * Searches the position within the time, node and stop limits, where nodes count the iterations.
+     * `positions` are the positions of the game up to it, moves repeating them are draws. The depth limit
+     * doesn't apply. The score is the expected result of the best move in thousandths, from 1000 for a sure
+     * win to -1000 for a sure loss, and the depth the deepest node of the tree.
+     */
+    Search::Result run(const BitBoard& board, const HashHistory& positions, const Search::Limits& limits)
+    {
+        auto start = std::chrono::steady_clock::now();
+        auto deadline = limits.time.count() > 0 ? start + limits.time : std::chrono::steady_clock::time_point::max();
+        reset();
+        
+        _root = board;
+        _positions = positions;
+        allocate(1);
+        expand(_nodes[0], board);
+        
+        Search::Result result;
+        Node& root = _nodes[0];
+        if (root.children == 0) {
+            result.score = -Search::kWin;
+            return result;
+        }
+        
+        result.move = _nodes[root.firstChild].move;
+        if (root.children > 1) {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _searching = true;
+                _running = _helpers.size();
+                ++_generation;
+            }
+            _condition.notify_all();
+            
+            std::mt19937_64 random(_options.seed);
+            auto lastProgress = start;
+            while (true) {
+                iterate(random);
+                
+                auto now = std::chrono::steady_clock::now();
+                bool outOfTime = now >= deadline && !(limits.pondering && *limits.pondering);
+                if (outOfTime || (limits.stop && *limits.stop) || (limits.nodes > 0 && _iterations >= limits.nodes)) {
+                    break;
+                }
+                
+                if (limits.progress && now - lastProgress >= kProgressInterval) {
+                    lastProgress = now;
+                    limits.progress(finish(start));
+                }
+            }
+            
+            _searching = false;
+            std::unique_lock<std::mutex> lock(_mutex);
+            _done.wait(lock, [this]() {
+                return _running == 0;
+            });
+        }
+        
+        return finish(start);
+    }
+    
+    static size_t randomPolicy(const BitBoard&, const BitBoard::MoveList& moves, std::mt19937_64& random)
+    {
+        return std::uniform_int_distribution<size_t>(0, moves.size() - 1)(random);
+    }
+    
+    /**
+     * Plays the move with the best evaluation for the mover most of the time and a random move otherwise,
+     * which makes the simulated games look more like real ones at the cost of fewer of them. The positions
+     * after all moves are evaluated as one batch.
+     */
+    static RolloutPolicy greedyPolicy(const Evaluation& evaluation, double randomness = 0.25)
+    {
+        return [batchEvaluation = BatchEvaluation(evaluation), randomness](const BitBoard& board, const BitBoard::MoveList& moves, std::mt19937_64& random) {
+            if (std::uniform_real_distribution<double>(0, 1)(random) < randomness) {
+                return randomPolicy(board, moves, random);
+            }
+            
+            thread_local PositionBatch batch;
+            thread_local std::vector<int32_t> scores;
+            batch.clear();
+            for (size_t i = 0; i < moves.size(); ++i) {
+                batch.add(board.apply(moves[i]));
+            }
+            scores.resize(batch.size());
+            batchEvaluation.evaluate(batch, scores.data());
+            
+            // The evaluation is from the point of view of the opponent, who moves next
+            return static_cast<size_t>(std::min_element(scores.begin(), scores.end()) - scores.begin());
+        };
+    }
+
+private:
+    static constexpr uint8_t kLeaf = 0;
+    static constexpr uint8_t kExpanding = 1;
+    static constexpr uint8_t kExpanded = 2;
+    static constexpr uint32_t kNoNode = std::numeric_limits<uint32_t>::max();
+    static constexpr int kMaxDepth = 256;
+    
+    // Results are summed as fixed point numbers, this is a win
+    static constexpr uint64_t kWin = 1 << 16;
+    static constexpr double kDraw = 0.5;
+    
+    // Evaluation that gives a simulated game cut short a 73% chance of winning
+    static constexpr double kEvaluationScale = 100;
+    
+    static constexpr std::chrono::milliseconds kProgressInterval{100};
+    
+    struct Node
+    {
+        BitBoard::Move move;
+        std::atomic<uint32_t> visits{0};
+        
+        // Sum of the results for the side that played `move`
+        std::atomic<uint64_t> results{0};
+        
+        uint32_t firstChild{kNoNode};
+        uint16_t children{0};
+        std::atomic<uint8_t> state{kLeaf};
+    };
+
+private:
+    /**
+     * Loop of helper thread `index`, iterating along with every run it is woken for until the search is
+     * destroyed.
+     */
+    void help(size_t index)
+    {
+        uint64_t generation = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _condition.wait(lock, [this, generation]() {
+                    return _quit || _generation != generation;
+                });
+                if (_quit) {
+                    return;
+                }
+                generation = _generation;
+            }
+            
+            std::mt19937_64 random(_options.seed + index);
+            while (_searching) {
+                iterate(random);
+            }
+            
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (--_running == 0) {
+                _done.notify_all();
+            }
+        }
+    }
+    
+    void reset()
+    {
+        size_t used = std::min<size_t>(_used, _capacity);
+        for (size_t i = 0; i < used; ++i) {
+            _nodes[i].visits = 0;
+            _nodes[i].results = 0;
+            _nodes[i].firstChild = kNoNode;
+            _nodes[i].children = 0;
+            _nodes[i].state = kLeaf;
+        }
+        
+        _used = 0;
+        _iterations = 0;
+        _depth = 0;
+    }
+    
+    uint32_t allocate(size_t count)
+    {
+        size_t first = _used.fetch_add(count);
+        return first + count <= _capacity ? static_cast<uint32_t>(first) : kNoNode;
+    }
+    
+    /**
+     * Adds the children of the node, unless another thread is already doing so or the pool is used up.
+     */
+    void expand(Node& node, const BitBoard& board)
+    {
+        uint8_t leaf = kLeaf;
+        if (!node.state.compare_exchange_strong(leaf, kExpanding)) {
+            return;
+        }
+        
+        BitBoard::MoveList moves;
+        board.generate(moves);
+        uint32_t first = allocate(moves.size());
+        if (first == kNoNode) {
+            node.state = kLeaf;
+            return;
+        }
+        
+        for (size_t i = 0; i < moves.size(); ++i) {
+            _nodes[first + i].move = moves[i];
+        }
+        node.firstChild = first;
+        node.children = static_cast<uint16_t>(moves.size());
+        node.state.store(kExpanded, std::memory_order_release);
+    }
+    
+    void iterate(std::mt19937_64& random)
+    {
+        std::array<Node*, kMaxDepth> path;
+        size_t length = 0;
+        BitBoard board = _root;
+        BitBoard::Undo undo;
+        HashHistory positions = _positions;
+        
+        Node* node = &_nodes[0];
+        node->visits += _options.virtualLoss;
+        path[length++] = node;
+        bool draw = false;
+        while (node->state.load(std::memory_order_acquire) == kExpanded && node->children > 0 && length < kMaxDepth) {
+            node = select(*node);
+            bool irreversible = HashHistory::irreversible(board, node->move);
+            board.make(node->move, undo);
+            positions.push(board.hash, irreversible);
+            node->visits += _options.virtualLoss;
+            path[length++] = node;
+            
+            // The path decides whether a node is a draw, and as every node has only one path it never changes
+            draw = positions.repeated() || positions.reversible() >= BitBoard::kDrawPlies;
+            if (draw) {
+                break;
+            }
+        }
+        
+        // Result for the side to move in the position of the last node
+        double result = 0;
+        if (draw) {
+            result = kDraw;
+        } else if (node->state.load(std::memory_order_acquire) != kExpanded || node->children > 0) {
+            expand(*node, board);
+            result = rollout(board, positions, random);
+        }
+        
+        // Every node holds the results of the side that moved into it, which alternates going up
+        double value = 1 - result;
+        for (size_t i = length; i-- > 0;) {
+            path[i]->results += static_cast<uint64_t>(value * kWin);
+            path[i]->visits -= _options.virtualLoss - 1;
+            value = 1 - value;
+        }
+        
+        ++_iterations;
+        size_t depth = _depth;
+        while (length - 1 > depth && !_depth.compare_exchange_weak(depth, length - 1)) {
+        
+        }
+    }
+    
+    /**
+     * The child with the highest upper confidence bound, children that were never visited first.
+     */
+    Node* select(const Node& node)
+    {
+        double logVisits = std::log(std::max<uint32_t>(node.visits, 1));
+        Node* best = nullptr;
+        double bestScore = -1;
+        for (uint32_t i = node.firstChild; i < node.firstChild + node.children; ++i) {
+            Node& child = _nodes[i];
+            uint32_t visits = child.visits.load(std::memory_order_relaxed);
+            if (visits == 0) {
+                return &child;
+            }
+            
+            double mean = static_cast<double>(child.results.load(std::memory_order_relaxed)) / kWin / visits;
+            double score = mean + _options.exploration * std::sqrt(logVisits / visits);
+            if (score > bestScore) {
+                bestScore = score;
+                best = &child;
+            }
+        }
+        
+        return best;
+    }
+    
+    /**
+     * Plays the position out with the rollout policy. Returns the result for the side to move, 1 for a
+     * win, 0 for a loss and a half for a draw, or the chance of winning the evaluation gives when the game
+     * takes too long.
+     */
+    double rollout(BitBoard board, HashHistory& positions, std::mt19937_64& random) const
+    {
+        auto color = board.turn;
+        BitBoard::MoveList moves;
+        BitBoard::Undo undo;
+        for (int ply = 0; ply < _options.rolloutPlies; ++ply) {
+            board.generate(moves);
+            if (moves.empty()) {
+                return board.turn == color ? 0 : 1;
+            }
+            
+            const BitBoard::Move& move = moves[_options.policy(board, moves, random)];
+            bool irreversible = HashHistory::irreversible(board, move);
+            board.make(move, undo);
+            positions.push(board.hash, irreversible);
+            if (positions.repeated() || positions.reversible() >= BitBoard::kDrawPlies) {
+                return kDraw;
+            }
+        }
+        
+        double chance = 1 / (1 + std::exp(-_evaluation.evaluate(board) / kEvaluationScale));
+        return board.turn == color ? chance : 1 - chance;
+    }
+    
+    /**
+     * The child visited most, or none when the node wasn't expanded or its children were never visited.
+     */
+    const Node* mostVisited(const Node& node) const
+    {
+        if (node.state.load(std::memory_order_acquire) != kExpanded) {
+            return nullptr;
+        }
+        
+        const Node* best = nullptr;
+        for (uint32_t i = node.firstChild; i < node.firstChild + node.children; ++i) {
+            if (_nodes[i].visits > 0 && (!best || _nodes[i].visits > best->visits)) {
+                best = &_nodes[i];
+            }
+        }
+        
+        return best;
+    }
+    
+    Search::Result finish(std::chrono::steady_clock::time_point start) const
+    {
+        const Node& root = _nodes[0];
+        const Node* best = &_nodes[root.firstChild];
+        for (uint32_t i = root.firstChild; i < root.firstChild + root.children; ++i) {
+            if (_nodes[i].visits > best->visits) {
+                best = &_nodes[i];
+            }
+        }
+        
+        Search::Result result;
+        result.move = best->move;
+        
+        // The line the tree spent the most visits on
+        for (const Node* node = best; node; node = mostVisited(*node)) {
+            result.principalVariation.push_back(node->move);
+        }
+        
+        // A move never visited, like the only move which isn't searched, says nothing about the result
+        if (best->visits > 0) {
+            double mean = static_cast<double>(best->results) / kWin / best->visits;
+            result.score = static_cast<int32_t>(std::lround((2 * mean - 1) * 1000));
+        }
+        result.depth = static_cast<int>(_depth);
+        result.nodes = _iterations;
+        result.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        return result;
+    }
+
+private:
+    Options _options;
+    Evaluation _evaluation;
+    
+    size_t _capacity;
+    std::unique_ptr<Node[]> _nodes;
+    std::atomic<size_t> _used{0};
+    
+    BitBoard _root;
+    HashHistory _positions;
+    std::atomic<uint64_t> _iterations{0};
+    std::atomic<size_t> _depth{0};
+    
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    std::condition_variable _done;
+    uint64_t _generation{0};
+    
+    // Helpers still iterating for the current run, which stop once searching is over
+    size_t _running{0};
+    std::atomic<bool> _searching{false};
+    bool _quit{false};
+    
+    std::vector<std::thread> _helpers;
+};
@@ -0,0 +1,331 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "BitBoard.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NETWORK_AVX2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define NETWORK_NEON
+#endif
+
+/**
+ * Evaluation by a small neural network, trained outside of the engine, as an alternative to the square
+ * tables of `Evaluation`.
+ *
+ * The first layer has one input per piece and square, seen from both sides: own men, own kings, opposing
+ * men and opposing kings on each square, the board turned around for black. A move only changes a few of
+ * these inputs, so the outputs of the first layer, the accumulator, are updated by adding and subtracting
+ * the weights of the changed inputs instead of computed from scratch. The search keeps an accumulator per
+ * ply, so taking back a move costs nothing. Both halves of the accumulator, the side to move first, then go
+ * through two small dense layers to the score.
+ *
+ * All arithmetic is on integers. Accumulator values are 16 bit and clipped to 0-127 before the dense layers,
+ * 127 standing for 1. Dense weights are 8 bit and scaled by 64, so the sums of the hidden dense layers are
+ * shifted right by 6 and clipped to 0-127 again. The sum of the output layer divided by 16 is the score in
+ * centipieces for the side to move. The dense layers use AVX2 or NEON when available.
+ *
+ * A network file is a header followed by the arrays of `Weights` in order, rows first, in the byte order of
+ * the machine that wrote it.
+ */
+class Network
+{
+public:
+    static constexpr int kInputs = 4 * BitBoard::kSquares;
+    static constexpr int kHidden = 128;
+    static constexpr int kDense = 32;
+    static constexpr int kWeightShift = 6;
+    static constexpr int kOutputDivisor = 16;
+    static constexpr int kActivationMax = 127;
+    
+    struct Weights
+    {
+        // Input to accumulator, one row per input
+        std::array<std::array<int16_t, kHidden>, kInputs> feature{};
+        std::array<int16_t, kHidden> featureBias{};
+        
+        // Dense layers, one row per output
+        std::array<std::array<int8_t, 2 * kHidden>, kDense> hidden{};
+        std::array<int32_t, kDense> hiddenBias{};
+        std::array<std::array<int8_t, kDense>, kDense> dense{};
+        std::array<int32_t, kDense> denseBias{};
+        std::array<int8_t, kDense> output{};
+        int32_t outputBias{0};
+    };
+    
+    struct Accumulator
+    {
+        // One half per side's point of view, by color
+        alignas(32) std::array<std::array<int16_t, kHidden>, 2> values;
+    };
+
+public:
+    Network(const Weights& weights)
+        : _weights(std::make_unique<Weights>(weights))
+    {
+#ifdef NETWORK_AVX2
+        _avx2 = __builtin_cpu_supports("avx2");
+#endif
+    }
+    
+    Network(const std::string& path)
+        : Network(Weights())
+    {
+        std::ifstream file(path, std::ios::binary);
+        Header header;
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0
+         || header.inputs != kInputs || header.hidden != kHidden || header.dense != kDense) {
+            throw std::runtime_error("invalid network " + path);
+        }
+        
+        forEachArray(*_weights, [&file](void* data, size_t size) {
+            file.read(static_cast<char*>(data), size);
+        });
+        if (!file || file.peek() != std::ifstream::traits_type::eof()) {
+            throw std::runtime_error("invalid network " + path);
+        }
+    }
+    
+    static void write(const std::string& path, const Weights& weights)
+    {
+        Header header;
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        forEachArray(weights, [&file](const void* data, size_t size) {
+            file.write(static_cast<const char*>(data), size);
+        });
+        if (!file) {
+            throw std::runtime_error("can't write network " + path);
+        }
+    }
+    
+    const Weights& weights() const
+    {
+        return *_weights;
+    }
+    
+    /**
+     * Index of the input for a piece seen from the side of `perspective`.
+     */
+    static int input(BitBoard::Color perspective, BitBoard::Color color, bool king, int square)
+    {
+        int piece = (color == perspective ? 0 : 2) + king;
+        return piece * BitBoard::kSquares + (perspective == BitBoard::Color::White ? square : BitBoard::kSquares - 1 - square);
+    }
+    
+    /**
+     * Computes the accumulator from scratch.
+     */
+    void refresh(const BitBoard& board, Accumulator& accumulator) const
+    {
+        for (auto perspective : {BitBoard::Color::White, BitBoard::Color::Black}) {
+            auto& values = accumulator.values[static_cast<int>(perspective)];
+            values = _weights->featureBias;
+            for (uint64_t pieces = board.white | board.black; pieces; pieces &= pieces - 1) {
+                int at = BitBoard::lowest(pieces);
+                auto color = board.white & (uint64_t{1} << at) ? BitBoard::Color::White : BitBoard::Color::Black;
+                add(values, _weights->feature[input(perspective, color, board.kings & (uint64_t{1} << at), BitBoard::square(at))]);
+            }
+        }
+    }
+    
+    /**
+     * Accumulator after `move`, which was just made on `board` by `BitBoard::make` and left `undo` behind,
+     * from the accumulator before it.
+     */
+    void update(const BitBoard& board, const BitBoard::Undo& undo, const BitBoard::Move& move, const Accumulator& before, Accumulator& after) const
+    {
+        auto color = !board.turn;
+        bool wasKing = undo.kings & BitBoard::mask(move.from);
+        bool isKing = board.kings & BitBoard::mask(move.to);
+        
+        after = before;
+        for (auto perspective : {BitBoard::Color::White, BitBoard::Color::Black}) {
+            auto& values = after.values[static_cast<int>(perspective)];
+            subtract(values, _weights->feature[input(perspective, color, wasKing, move.from)]);
+            add(values, _weights->feature[input(perspective, color, isKing, move.to)]);
+            for (uint64_t captured = move.captured; captured; captured &= captured - 1) {
+                int at = BitBoard::lowest(captured);
+                subtract(values, _weights->feature[input(perspective, !color, undo.kings & (uint64_t{1} << at), BitBoard::square(at))]);
+            }
+        }
+    }
+    
+    /**
+     * Score for the side to move, given the accumulator of the position.
+     */
+    int32_t evaluate(const BitBoard& board, const Accumulator& accumulator) const
+    {
+        alignas(32) std::array<uint8_t, 2 * kHidden> inputs;
+        int us = static_cast<int>(board.turn);
+        clip(accumulator.values[us].data(), inputs.data());
+        clip(accumulator.values[1 - us].data(), inputs.data() + kHidden);
+        
+        alignas(32) std::array<uint8_t, kDense> hidden;
+        for (int i = 0; i < kDense; ++i) {
+            hidden[i] = activation(_weights->hiddenBias[i] + dot(inputs.data(), _weights->hidden[i].data(), 2 * kHidden));
+        }
+        
+        alignas(32) std::array<uint8_t, kDense> dense;
+        for (int i = 0; i < kDense; ++i) {
+            dense[i] = activation(_weights->denseBias[i] + dot(hidden.data(), _weights->dense[i].data(), kDense));
+        }
+        
+        return (_weights->outputBias + dot(dense.data(), _weights->output.data(), kDense)) / kOutputDivisor;
+    }
+    
+    int32_t evaluate(const BitBoard& board) const
+    {
+        Accumulator accumulator;
+        refresh(board, accumulator);
+        return evaluate(board, accumulator);
+    }
+
+private:
+    static constexpr char kMagic[4] = {'D', 'N', 'N', '1'};
+    
+    struct Header
+    {
+        char magic[4];
+        uint32_t inputs{kInputs};
+        uint32_t hidden{kHidden};
+        uint32_t dense{kDense};
+    };
+
+private:
+    /**
+     * Calls `function` with the data and size of every array of the weights, in file order.
+     */
+    template <typename AnyWeights, typename Function>
+    static void forEachArray(AnyWeights& weights, Function function)
+    {
+        function(weights.feature.data(), sizeof(weights.feature));
+        function(weights.featureBias.data(), sizeof(weights.featureBias));
+        function(weights.hidden.data(), sizeof(weights.hidden));
+        function(weights.hiddenBias.data(), sizeof(weights.hiddenBias));
+        function(weights.dense.data(), sizeof(weights.dense));
+        function(weights.denseBias.data(), sizeof(weights.denseBias));
+        function(weights.output.data(), sizeof(weights.output));
+        function(&weights.outputBias, sizeof(weights.outputBias));
+    }
+    
+    static void add(std::array<int16_t, kHidden>& values, const std::array<int16_t, kHidden>& weights)
+    {
+        for (int i = 0; i < kHidden; ++i) {
+            values[i] += weights[i];
+        }
+    }
+    
+    static void subtract(std::array<int16_t, kHidden>& values, const std::array<int16_t, kHidden>& weights)
+    {
+        for (int i = 0; i < kHidden; ++i) {
+            values[i] -= weights[i];
+        }
+    }
+    
+    static uint8_t activation(int32_t sum)
+    {
+        return static_cast<uint8_t>(std::clamp(sum >> kWeightShift, 0, kActivationMax));
+    }
+    
+    void clip(const int16_t* values, uint8_t* activations) const
+    {
+#ifdef NETWORK_AVX2
+        if (_avx2) {
+            clipAvx2(values, activations);
+            return;
+        }
+#endif
+        for (int i = 0; i < kHidden; ++i) {
+            activations[i] = static_cast<uint8_t>(std::clamp<int>(values[i], 0, kActivationMax));
+        }
+    }
+    
+    /**
+     * Sum of the products of activations and weights, `size` being a multiple of 32.
+     */
+    int32_t dot(const uint8_t* activations, const int8_t* weights, int size) const
+    {
+#ifdef NETWORK_AVX2
+        if (_avx2) {
+            return dotAvx2(activations, weights, size);
+        }
+#endif
+#ifdef NETWORK_NEON
+        return dotNeon(activations, weights, size);
+#else
+        int32_t sum = 0;
+        for (int i = 0; i < size; ++i) {
+            sum += activations[i] * weights[i];
+        }
+        
+        return sum;
+#endif
+    }
+
+#ifdef NETWORK_AVX2
+    __attribute__((target("avx2"))) static void clipAvx2(const int16_t* values, uint8_t* activations)
+    {
+        for (int i = 0; i < kHidden; i += 32) {
+            __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+            __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i + 16));
+            
+            // Packing saturates to -128-127 but interleaves the 128 bit halves, which the permute undoes
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(low, high), 0xd8);
+            packed = _mm256_max_epi8(packed, _mm256_setzero_si256());
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(activations + i), packed);
+        }
+    }
+    
+    __attribute__((target("avx2"))) static int32_t dotAvx2(const uint8_t* activations, const int8_t* weights, int size)
+    {
+        const __m256i ones = _mm256_set1_epi16(1);
+        __m256i sum = _mm256_setzero_si256();
+        for (int i = 0; i < size; i += 32) {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(activations + i));
+            __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + i));
+            
+            // Activations are at most 127, so the sums of two products fit in 16 bits without saturating
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(a, w), ones));
+        }
+        
+        __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtsi128_si32(half);
+    }
+#endif
+
+#ifdef NETWORK_NEON
+    static int32_t dotNeon(const uint8_t* activations, const int8_t* weights, int size)
+    {
+        int32x4_t sum = vdupq_n_s32(0);
+        for (int i = 0; i < size; i += 16) {
+            // Activations are at most 127, so they can be read as signed
+            int8x16_t a = vreinterpretq_s8_u8(vld1q_u8(activations + i));
+            int8x16_t w = vld1q_s8(weights + i);
+            int16x8_t products = vmull_s8(vget_low_s8(a), vget_low_s8(w));
+            products = vmlal_s8(products, vget_high_s8(a), vget_high_s8(w));
+            sum = vpadalq_s16(sum, products);
+        }
+        
+        return vgetq_lane_s32(sum, 0) + vgetq_lane_s32(sum, 1) + vgetq_lane_s32(sum, 2) + vgetq_lane_s32(sum, 3);
+    }
+#endif
+
+private:
+    std::unique_ptr<Weights> _weights;
+    bool _avx2{false};
+};
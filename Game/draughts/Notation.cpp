@@ -0,0 +1 @@
+#include "Notation.hpp"
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "BitBoard.hpp"
+
+/**
+ * Conversion between positions and moves and the standard text notation of international draughts, where
+ * squares are numbered 1-50.
+ */
+class Notation
+{
+public:
+    /**
+     * Parses a FEN string like "W:W31-50:B1-20" or "B:W31,K32:BK5,10". The first field is the side to move,
+     * followed by the pieces of each color as square numbers or ranges, kings prefixed by a K.
+     */
+    static BitBoard fromFen(const std::string& fen)
+    {
+        std::stringstream stream(fen);
+        std::string field;
+        
+        if (!std::getline(stream, field, ':') || (field != "W" && field != "B")) {
+            throw std::runtime_error("invalid FEN, missing side to move: " + fen);
+        }
+        
+        BitBoard board;
+        board.setTurn(field == "W" ? BitBoard::Color::White : BitBoard::Color::Black);
+        
+        while (std::getline(stream, field, ':')) {
+            // Some sources end the FEN with a full stop
+            if (!field.empty() && field.back() == '.') {
+                field.pop_back();
+            }
+            
+            if (field.empty() || (field[0] != 'W' && field[0] != 'B')) {
+                throw std::runtime_error("invalid FEN, unknown color: " + fen);
+            }
+            
+            auto color = field[0] == 'W' ? BitBoard::Color::White : BitBoard::Color::Black;
+            std::stringstream pieces(field.substr(1));
+            std::string piece;
+            while (std::getline(pieces, piece, ',')) {
+                if (piece.empty()) {
+                    continue;
+                }
+                
+                bool king = piece[0] == 'K';
+                if (king) {
+                    piece.erase(0, 1);
+                }
+                
+                auto range = piece.find('-');
+                int first = parseSquare(piece.substr(0, range), "invalid FEN", fen);
+                int last = range == std::string::npos ? first : parseSquare(piece.substr(range + 1), "invalid FEN", fen);
+                for (int square = first; square <= last; ++square) {
+                    if ((board.white | board.black) & BitBoard::mask(square)) {
+                        throw std::runtime_error("invalid FEN, square used twice: " + fen);
+                    }
+                    
+                    board.set(square, color, king);
+                }
+            }
+        }
+        
+        return board;
+    }
+    
+    static std::string fen(const BitBoard& board)
+    {
+        std::string fen = board.turn == BitBoard::Color::White ? "W" : "B";
+        for (auto color : {BitBoard::Color::White, BitBoard::Color::Black}) {
+            fen += color == BitBoard::Color::White ? ":W" : ":B";
+            
+            uint64_t pieces = color == BitBoard::Color::White ? board.white : board.black;
+            bool first = true;
+            for (int square = 0; square < BitBoard::kSquares; ++square) {
+                if (!(pieces & BitBoard::mask(square))) {
+                    continue;
+                }
+                
+                fen += first ? "" : ",";
+                fen += board.kings & BitBoard::mask(square) ? "K" : "";
+                fen += std::to_string(square + 1);
+                first = false;
+            }
+        }
+        
+        return fen;
+    }
+    
+    /**
+     * Short notation of a move, "32-28" for a step and "28x17" for a capture.
+     */
+    static std::string move(const BitBoard::Move& move)
+    {
+        return std::to_string(move.from + 1) + (move.captures > 0 ? "x" : "-") + std::to_string(move.to + 1);
+    }
+
+    /**
+     * Finds the legal move written as "32-28" or "28x17" in the position. Captures that can take different
+     * routes between the same squares are told apart by listing the squares in between, as in "28x19x10".
+     */
+    static BitBoard::Move parseMove(const BitBoard& board, const std::string& text)
+    {
+        std::vector<int> squares;
+        std::string square;
+        for (char c : text + "-") {
+            if (c == '-' || c == 'x' || c == 'X') {
+                squares.push_back(parseSquare(square, "invalid move", text));
+                square.clear();
+            } else {
+                square += c;
+            }
+        }
+        
+        if (squares.size() < 2) {
+            throw std::runtime_error("invalid move, missing destination: " + text);
+        }
+        
+        BitBoard::MoveList moves;
+        board.generate(moves);
+        
+        const BitBoard::Move* found = nullptr;
+        for (auto&& move : moves) {
+            if (move.from != squares.front() || move.to != squares.back()) {
+                continue;
+            }
+            
+            // Squares in between have to be landing squares of the route, in order
+            bool matches = true;
+            size_t hop = 0;
+            for (size_t i = 1; i + 1 < squares.size() && matches; ++i) {
+                while (hop < move.captures && move.path[hop] != squares[i]) {
+                    ++hop;
+                }
+                matches = hop++ < move.captures;
+            }
+            if (!matches) {
+                continue;
+            }
+            
+            if (found) {
+                throw std::runtime_error("ambiguous move: " + text);
+            }
+            found = &move;
+        }
+        
+        if (!found) {
+            throw std::runtime_error("illegal move: " + text);
+        }
+        
+        return *found;
+    }
+
+private:
+    static int parseSquare(const std::string& text, const std::string& error, const std::string& source)
+    {
+        try {
+            size_t parsed = 0;
+            int square = std::stoi(text, &parsed);
+            if (parsed == text.size() && square >= 1 && square <= BitBoard::kSquares) {
+                return square - 1;
+            }
+        } catch (const std::logic_error&) {
+            // Reported below, together with out of range squares
+        }
+        
+        throw std::runtime_error(error + ", bad square '" + text + "': " + source);
+    }
+};
@@ -0,0 +1 @@
+#include "OpeningBook.hpp"
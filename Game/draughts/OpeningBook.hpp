@@ -0,0 +1,144 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "BitBoard.hpp"
+#include "MappedFile.hpp"
+
+/**
+ * Moves known to be good in the opening, looked up by position instead of searched.
+ *
+ * The book file is a header followed by fixed size entries sorted by position hash, one per position and
+ * move, so a lookup is a binary search through the memory mapped file. Entries are stored in the byte order
+ * of the machine that built the book.
+ */
+class OpeningBook
+{
+public:
+    struct Entry
+    {
+        uint64_t hash;
+        uint64_t captured;
+        uint32_t weight;
+        uint8_t from;
+        uint8_t to;
+        uint16_t reserved;
+    };
+
+public:
+    OpeningBook(const std::string& path)
+        : _file(path)
+    {
+        Header header;
+        if (_file.size() < sizeof(Header)) {
+            throw std::runtime_error("invalid opening book " + path);
+        }
+        
+        std::memcpy(&header, _file.data(), sizeof(Header));
+        if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || _file.size() != sizeof(Header) + header.entries * sizeof(Entry)) {
+            throw std::runtime_error("invalid opening book " + path);
+        }
+        
+        _entries = reinterpret_cast<const Entry*>(_file.data() + sizeof(Header));
+        _size = header.entries;
+    }
+    
+    size_t size() const
+    {
+        return _size;
+    }
+    
+    /**
+     * The book moves of the position with their weights. Entries of another position with the same hash
+     * are left out because their move isn't legal here.
+     */
+    std::vector<std::pair<BitBoard::Move, uint32_t>> moves(const BitBoard& board) const
+    {
+        std::vector<std::pair<BitBoard::Move, uint32_t>> moves;
+        auto [first, last] = std::equal_range(_entries, _entries + _size, Entry{board.hash, 0, 0, 0, 0, 0}, [](const Entry& a, const Entry& b) {
+            return a.hash < b.hash;
+        });
+        if (first == last) {
+            return moves;
+        }
+        
+        BitBoard::MoveList legalMoves;
+        board.generate(legalMoves);
+        for (auto entry = first; entry != last; ++entry) {
+            for (auto&& move : legalMoves) {
+                if (move.from == entry->from && move.to == entry->to && move.captured == entry->captured) {
+                    moves.emplace_back(move, entry->weight);
+                }
+            }
+        }
+        
+        return moves;
+    }
+    
+    /**
+     * Picks one of the book moves at random, moves with a higher weight more often. Returns false when the
+     * position isn't in the book.
+     */
+    bool pick(const BitBoard& board, BitBoard::Move& move, std::mt19937_64& random) const
+    {
+        auto moves = this->moves(board);
+        uint64_t total = 0;
+        for (auto&& [bookMove, weight] : moves) {
+            total += weight;
+        }
+        if (total == 0) {
+            return false;
+        }
+        
+        uint64_t pick = std::uniform_int_distribution<uint64_t>(0, total - 1)(random);
+        for (auto&& [bookMove, weight] : moves) {
+            if (pick < weight) {
+                move = bookMove;
+                break;
+            }
+            pick -= weight;
+        }
+        
+        return true;
+    }
+    
+    static void write(const std::string& path, std::vector<Entry> entries)
+    {
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+            return a.hash < b.hash;
+        });
+        
+        Header header;
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.entries = entries.size();
+        
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(Entry));
+        if (!file) {
+            throw std::runtime_error("can't write opening book " + path);
+        }
+    }
+
+private:
+    static constexpr char kMagic[8] = {'D', 'O', 'B', '1', 0, 0, 0, 0};
+    
+    struct Header
+    {
+        char magic[8];
+        uint64_t entries;
+    };
+
+private:
+    MappedFile _file;
+    const Entry* _entries{nullptr};
+    size_t _size{0};
+};
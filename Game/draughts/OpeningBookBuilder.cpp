@@ -0,0 +1 @@
+#include "OpeningBookBuilder.hpp"
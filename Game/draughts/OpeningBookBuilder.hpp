@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "BitBoard.hpp"
+#include "Notation.hpp"
+#include "OpeningBook.hpp"
+
+/**
+ * Collects the opening moves of finished games into an opening book. Every move played in the first plies
+ * is weighted by how it worked out for the side that played it, two points per win and one per draw, so
+ * moves that only lost never make it into the book.
+ */
+class OpeningBookBuilder
+{
+public:
+    struct Options
+    {
+        // Moves played after this many plies are left out
+        int plies{16};
+        
+        // Moves played in fewer games are left out, a single game says little about a move
+        uint32_t minGames{2};
+    };
+    
+    enum class Outcome
+    {
+        WhiteWins,
+        BlackWins,
+        Draw
+    };
+
+public:
+    OpeningBookBuilder(const Options& options)
+        : _options(options)
+    {
+    
+    }
+    
+    /**
+     * Adds a game played from the initial position.
+     */
+    void add(const std::vector<BitBoard::Move>& moves, Outcome outcome)
+    {
+        BitBoard board = BitBoard::initial();
+        for (size_t ply = 0; ply < moves.size() && static_cast<int>(ply) < _options.plies; ++ply) {
+            const auto& move = moves[ply];
+            auto& statistics = _moves[{board.hash, move.captured, move.from, move.to}];
+            ++statistics.games;
+            
+            bool won = outcome == (board.turn == BitBoard::Color::White ? Outcome::WhiteWins : Outcome::BlackWins);
+            statistics.points += won ? 2 : outcome == Outcome::Draw ? 1 : 0;
+            board = board.apply(move);
+        }
+        ++_games;
+    }
+    
+    /**
+     * Adds a game written as its moves, like "1. 32-28 19-23 2. 28x19 14x23 2-0". Move numbers are skipped and
+     * the result, in either the 2-0 or the 1-0 convention, is optional but games without one count as drawn.
+     */
+    void add(const std::string& record)
+    {
+        std::stringstream stream(record);
+        std::string token;
+        BitBoard board = BitBoard::initial();
+        std::vector<BitBoard::Move> moves;
+        Outcome outcome = Outcome::Draw;
+        while (stream >> token) {
+            // Move numbers, possibly written against the move as in "1.32-28"
+            auto dot = token.rfind('.');
+            if (dot != std::string::npos) {
+                token.erase(0, dot + 1);
+            }
+            if (token.empty() || token == "*") {
+                continue;
+            }
+            
+            if (token == "2-0" || token == "1-0") {
+                outcome = Outcome::WhiteWins;
+            } else if (token == "0-2" || token == "0-1") {
+                outcome = Outcome::BlackWins;
+            } else if (token == "1-1" || token == "1/2-1/2") {
+                outcome = Outcome::Draw;
+            } else {
+                moves.push_back(Notation::parseMove(board, token));
+                board = board.apply(moves.back());
+            }
+        }
+        
+        add(moves, outcome);
+    }
+    
+    size_t games() const
+    {
+        return _games;
+    }
+    
+    std::vector<OpeningBook::Entry> entries() const
+    {
+        std::vector<OpeningBook::Entry> entries;
+        for (auto&& [key, statistics] : _moves) {
+            if (statistics.games < _options.minGames || statistics.points == 0) {
+                continue;
+            }
+            
+            auto&& [hash, captured, from, to] = key;
+            entries.push_back(OpeningBook::Entry{hash, captured, statistics.points, from, to, 0});
+        }
+        
+        return entries;
+    }
+    
+    void write(const std::string& path) const
+    {
+        OpeningBook::write(path, entries());
+    }
+
+private:
+    struct Statistics
+    {
+        uint32_t games{0};
+        uint32_t points{0};
+    };
+
+private:
+    Options _options;
+    std::map<std::tuple<uint64_t, uint64_t, uint8_t, uint8_t>, Statistics> _moves;
+    size_t _games{0};
+};
@@ -0,0 +1 @@
+#include "ParallelSearch.hpp"
@@ -0,0 +1,267 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "BitBoard.hpp"
+#include "Evaluation.hpp"
+#include "HashHistory.hpp"
+#include "Network.hpp"
+#include "Tablebase.hpp"
+#include "Search.hpp"
+#include "TranspositionTable.hpp"
+
+/**
+ * Lazy SMP: runs the same search on several threads that only share the transposition table. The threads
+ * keep their own move lists and history, and because they start at different depths and finish at
+ * different times they fill the table with results the other threads can use.
+ *
+ * The helper threads live as long as the search and sleep between searches, each search wakes them by
+ * bumping a generation counter and waits until all of them reported back.
+ */
+class ParallelSearch
+{
+public:
+    struct Thread
+    {
+        uint64_t nodes{0};
+        uint64_t nodesPerSecond{0};
+        int depth{0};
+    };
+    
+    struct Result
+    {
+        Search::Result best;
+        std::vector<Thread> threads;
+    };
+
+public:
+    ParallelSearch(std::shared_ptr<TranspositionTable> table, size_t threads = std::thread::hardware_concurrency())
+        : _table(table)
+    {
+        setThreads(threads);
+    }
+    
+    ~ParallelSearch()
+    {
+        stopHelpers();
+    }
+    
+    /**
+     * Replaces the searches and helper threads, not while a search runs.
+     */
+    void setThreads(size_t threads)
+    {
+        stopHelpers();
+        
+        _searches.clear();
+        for (size_t i = 0; i < std::max<size_t>(threads, 1); ++i) {
+            _searches.emplace_back(std::make_unique<Search>(_table));
+            _searches.back()->setEvaluation(_evaluation);
+            _searches.back()->setTablebase(_tablebase);
+            _searches.back()->setNetwork(_network);
+        }
+        
+        for (size_t i = 1; i < _searches.size(); ++i) {
+            _helpers.emplace_back([this, i, generation = _generation]() {
+                help(i, generation);
+            });
+        }
+    }
+    
+    void setEvaluation(const Evaluation& evaluation)
+    {
+        _evaluation = evaluation;
+        for (auto&& search : _searches) {
+            search->setEvaluation(evaluation);
+        }
+    }
+    
+    const Evaluation& evaluation() const
+    {
+        return _evaluation;
+    }
+    
+    void setTablebase(std::shared_ptr<const Tablebase> tablebase)
+    {
+        _tablebase = tablebase;
+        for (auto&& search : _searches) {
+            search->setTablebase(tablebase);
+        }
+    }
+    
+    void setNetwork(std::shared_ptr<const Network> network)
+    {
+        _network = network;
+        for (auto&& search : _searches) {
+            search->setNetwork(network);
+        }
+    }
+    
+    size_t threads() const
+    {
+        return _deterministic ? 1 : _searches.size();
+    }
+    
+    /**
+     * Deterministic searches use a single thread, ignore the time budget and start with an empty
+     * transposition table and history, so the same position and depth always give the same result.
+     */
+    void setDeterministic(bool deterministic)
+    {
+        _deterministic = deterministic;
+    }
+    
+    Result run(const BitBoard& board, Search::Limits limits)
+    {
+        return run(board, HashHistory(board), limits);
+    }
+    
+    /**
+     * Searches the position within the limits, `positions` are the positions of the game up to it. When the
+     * limits carry their own stop flag only that flag stops the search, which unlike `stop` can't be missed
+     * by a search that hasn't started yet.
+     */
+    Result run(const BitBoard& board, const HashHistory& positions, Search::Limits limits)
+    {
+        _stop = false;
+        Search::Limits mainLimits = limits;
+        if (!mainLimits.stop) {
+            mainLimits.stop = &_stop;
+        }
+        
+        // Helpers stop with the main thread, which alone reports progress
+        limits.stop = &_stop;
+        limits.progress = nullptr;
+        
+        if (_deterministic) {
+            limits.time = std::chrono::milliseconds(0);
+            mainLimits.time = limits.time;
+            _table->clear();
+            _searches[0]->clearHistory();
+        }
+        _table->newSearch();
+        
+        std::vector<Search::Result> results(threads());
+        if (threads() > 1) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _job = Job{&board, &positions, &limits, &results};
+            _running = _helpers.size();
+            ++_generation;
+            _condition.notify_all();
+        }
+        
+        // Helpers only feed the table, once the main thread is done they are too
+        results[0] = _searches[0]->run(board, positions, mainLimits);
+        _stop = true;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _done.wait(lock, [this]() {
+                return _running == 0;
+            });
+        }
+        
+        Result result;
+        result.best = results[0];
+        for (auto&& threadResult : results) {
+            Thread thread;
+            thread.nodes = threadResult.nodes + threadResult.qnodes;
+            thread.nodesPerSecond = threadResult.nodesPerSecond();
+            thread.depth = threadResult.depth;
+            result.threads.emplace_back(thread);
+        }
+        
+        return result;
+    }
+    
+    /**
+     * Stops a running search without a stop flag of its own, which then returns the best move found so far.
+     */
+    void stop()
+    {
+        _stop = true;
+    }
+
+private:
+    // Search the helpers are woken for, only valid while it runs
+    struct Job
+    {
+        const BitBoard* board;
+        const HashHistory* positions;
+        const Search::Limits* limits;
+        std::vector<Search::Result>* results;
+    };
+
+private:
+    /**
+     * Loop of helper thread `index`, running every search after `generation` it is woken for until the
+     * helpers are stopped.
+     */
+    void help(size_t index, uint64_t generation)
+    {
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _condition.wait(lock, [this, generation]() {
+                    return _quit || _generation != generation;
+                });
+                if (_quit) {
+                    return;
+                }
+                generation = _generation;
+                job = _job;
+            }
+            
+            Search::Result result = _searches[index]->run(*job.board, *job.positions, *job.limits, 1 + static_cast<int>(index % 2));
+            
+            std::lock_guard<std::mutex> lock(_mutex);
+            (*job.results)[index] = result;
+            if (--_running == 0) {
+                _done.notify_all();
+            }
+        }
+    }
+    
+    void stopHelpers()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _quit = true;
+        }
+        _condition.notify_all();
+        for (auto&& helper : _helpers) {
+            helper.join();
+        }
+        
+        _helpers.clear();
+        _quit = false;
+    }
+
+private:
+    std::shared_ptr<TranspositionTable> _table;
+    std::vector<std::unique_ptr<Search>> _searches;
+    Evaluation _evaluation;
+    std::shared_ptr<const Tablebase> _tablebase;
+    std::shared_ptr<const Network> _network;
+    std::atomic<bool> _stop{false};
+    bool _deterministic{false};
+    
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    std::condition_variable _done;
+    Job _job{};
+    uint64_t _generation{0};
+    
+    // Helpers still running the current search
+    size_t _running{0};
+    bool _quit{false};
+    
+    std::vector<std::thread> _helpers;
+};
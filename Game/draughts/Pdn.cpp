@@ -0,0 +1 @@
+#include "Pdn.hpp"
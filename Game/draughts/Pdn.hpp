@@ -0,0 +1,261 @@
+#pragma once
+
+#include <cctype>
+#include <istream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "BitBoard.hpp"
+#include "Notation.hpp"
+
+/**
+ * Reading and writing games in Portable Draughts Notation: tag pairs like [White "Name"], followed by the
+ * numbered moves and the result. A FEN tag sets up a position other than the initial one. Comments,
+ * variations and annotations are skipped when reading.
+ */
+class Pdn
+{
+public:
+    struct Game
+    {
+        std::vector<std::pair<std::string, std::string>> tags;
+        BitBoard start{BitBoard::initial()};
+        std::vector<BitBoard::Move> moves;
+        
+        // "2-0" when white won, "0-2" when black won, "1-1" for a draw and "*" when unknown
+        std::string result{"*"};
+        
+        std::string tag(const std::string& name) const
+        {
+            for (auto&& [tagName, value] : tags) {
+                if (tagName == name) {
+                    return value;
+                }
+            }
+            
+            return "";
+        }
+        
+        void setTag(const std::string& name, const std::string& value)
+        {
+            for (auto&& [tagName, tagValue] : tags) {
+                if (tagName == name) {
+                    tagValue = value;
+                    return;
+                }
+            }
+            
+            tags.emplace_back(name, value);
+        }
+    };
+
+public:
+    static std::vector<Game> parse(std::istream& input)
+    {
+        std::vector<Game> games;
+        Game game;
+        BitBoard board = game.start;
+        bool started = false;
+        bool inMoves = false;
+        
+        auto finish = [&]() {
+            if (started) {
+                games.emplace_back(std::move(game));
+            }
+            game = Game();
+            board = game.start;
+            started = false;
+            inMoves = false;
+        };
+        
+        char c;
+        while (input.get(c)) {
+            if (std::isspace(static_cast<unsigned char>(c))) {
+                continue;
+            }
+            
+            if (c == '[') {
+                // Tags after moves start the next game, even when the previous one had no result
+                if (inMoves) {
+                    finish();
+                }
+                
+                std::string tag;
+                std::getline(input, tag, ']');
+                parseTag(tag, game, board, games.size() + 1);
+                started = true;
+            } else if (c == '{') {
+                input.ignore(std::numeric_limits<std::streamsize>::max(), '}');
+            } else if (c == ';') {
+                input.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            } else if (c == '(') {
+                skipVariation(input);
+            } else {
+                std::string token(1, c);
+                while (input.get(c) && !std::isspace(static_cast<unsigned char>(c)) && std::string("[{(;").find(c) == std::string::npos) {
+                    token += c;
+                }
+                if (input && !std::isspace(static_cast<unsigned char>(c))) {
+                    input.unget();
+                }
+                
+                started = true;
+                inMoves = true;
+                if (isResult(token)) {
+                    game.result = token;
+                    finish();
+                } else {
+                    parseMove(token, game, board, games.size() + 1);
+                }
+            }
+        }
+        
+        finish();
+        return games;
+    }
+    
+    static std::vector<Game> parse(const std::string& text)
+    {
+        std::stringstream stream(text);
+        return parse(stream);
+    }
+    
+    static std::string write(const Game& game)
+    {
+        Game tagged = game;
+        tagged.setTag("Result", game.result);
+        if (game.start.white != BitBoard::initial().white || game.start.black != BitBoard::initial().black
+         || game.start.kings || game.start.turn != BitBoard::Color::White) {
+            tagged.setTag("FEN", Notation::fen(game.start));
+        }
+        
+        std::string text;
+        for (auto&& [name, value] : tagged.tags) {
+            text += "[" + name + " \"" + value + "\"]\n";
+        }
+        text += "\n";
+        
+        // Moves are wrapped at 80 columns
+        std::string line;
+        auto append = [&](const std::string& token) {
+            if (!line.empty() && line.size() + 1 + token.size() > kLineLength) {
+                text += line + "\n";
+                line.clear();
+            }
+            line += (line.empty() ? "" : " ") + token;
+        };
+        
+        BitBoard board = game.start;
+        int number = 1;
+        if (board.turn == BitBoard::Color::Black) {
+            append("1...");
+        }
+        for (auto&& move : game.moves) {
+            if (board.turn == BitBoard::Color::White) {
+                append(std::to_string(number) + ".");
+            }
+            append(moveText(board, move));
+            
+            number += board.turn == BitBoard::Color::Black;
+            board = board.apply(move);
+        }
+        
+        append(game.result);
+        return text + line + "\n";
+    }
+
+private:
+    static constexpr size_t kLineLength = 80;
+    
+    static bool isResult(const std::string& token)
+    {
+        return token == "2-0" || token == "0-2" || token == "1-1" || token == "0-0" || token == "*"
+            || token == "1-0" || token == "0-1" || token == "1/2-1/2";
+    }
+    
+    static void parseTag(const std::string& tag, Game& game, BitBoard& board, size_t number)
+    {
+        auto quote = tag.find('"');
+        auto closingQuote = tag.rfind('"');
+        if (quote == std::string::npos || closingQuote == quote) {
+            throw std::runtime_error("invalid PDN tag in game " + std::to_string(number) + ": [" + tag + "]");
+        }
+        
+        std::string name = tag.substr(0, quote);
+        name.erase(name.find_last_not_of(" \t") + 1);
+        std::string value = tag.substr(quote + 1, closingQuote - quote - 1);
+        game.setTag(name, value);
+        
+        if (name == "FEN") {
+            game.start = Notation::fromFen(value);
+            board = game.start;
+        }
+    }
+    
+    static void parseMove(std::string token, Game& game, BitBoard& board, size_t number)
+    {
+        // Move numbers, possibly written against the move as in "1.32-28"
+        auto dot = token.rfind('.');
+        if (dot != std::string::npos) {
+            token.erase(0, dot + 1);
+        }
+        
+        // Annotations like "32-28!?"
+        while (!token.empty() && (token.back() == '!' || token.back() == '?' || token.back() == '+')) {
+            token.pop_back();
+        }
+        
+        // Numeric annotation glyphs like "$1"
+        if (token.empty() || token[0] == '$') {
+            return;
+        }
+        
+        try {
+            game.moves.push_back(Notation::parseMove(board, token));
+        } catch (const std::runtime_error& e) {
+            throw std::runtime_error("game " + std::to_string(number) + ", move " + std::to_string(game.moves.size() + 1) + ": " + e.what());
+        }
+        board = board.apply(game.moves.back());
+    }
+    
+    static void skipVariation(std::istream& input)
+    {
+        int depth = 1;
+        char c;
+        while (depth > 0 && input.get(c)) {
+            if (c == '{') {
+                input.ignore(std::numeric_limits<std::streamsize>::max(), '}');
+            } else {
+                depth += c == '(' ? 1 : c == ')' ? -1 : 0;
+            }
+        }
+    }
+    
+    /**
+     * The short notation of the move, or its full route when another capture shares its start and end.
+     */
+    static std::string moveText(const BitBoard& board, const BitBoard::Move& move)
+    {
+        BitBoard::MoveList moves;
+        board.generate(moves);
+        
+        bool ambiguous = false;
+        for (auto&& other : moves) {
+            ambiguous |= other.from == move.from && other.to == move.to && other != move;
+        }
+        if (!ambiguous) {
+            return Notation::move(move);
+        }
+        
+        std::string text = std::to_string(move.from + 1);
+        for (int hop = 0; hop < move.captures; ++hop) {
+            text += "x" + std::to_string(move.path[hop] + 1);
+        }
+        
+        return text;
+    }
+};
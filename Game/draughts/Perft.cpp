@@ -0,0 +1 @@
+#include "Perft.hpp"
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "BitBoard.hpp"
+#include "Variant.hpp"
+
+/**
+ * Settings of a perft count, the same for every variant.
+ */
+struct PerftOptions
+{
+    // Count the moves of the last ply instead of playing them
+    bool bulk{true};
+    
+    // Megabytes for caching subtree counts, zero disables the cache
+    size_t hashMegabytes{0};
+    
+    // Copy the board for every move instead of making and taking back moves on one board
+    bool copyMake{false};
+};
+
+/**
+ * Counts the leaf nodes of the game tree to a fixed depth, the standard way to validate a move generator
+ * against published numbers and to benchmark it.
+ */
+template <typename Variant>
+class BasicPerft
+{
+public:
+    using Board = BasicBitBoard<Variant>;
+    
+    static constexpr int kMaxDepth = 32;
+    
+    using Options = PerftOptions;
+    
+    struct Reference
+    {
+        std::string name;
+        
+        // Empty for the initial position of the variant
+        std::string fen;
+        
+        // Published leaf counts for depth 1, 2, ...
+        std::vector<uint64_t> nodes;
+    };
+
+public:
+    BasicPerft()
+        : BasicPerft(Options())
+    {
+    
+    }
+    
+    BasicPerft(Options options)
+        : _options(options)
+        , _moveLists(kMaxDepth + 1)
+    {
+        if (_options.hashMegabytes > 0) {
+            size_t entries = 1;
+            while (entries * 2 * sizeof(Entry) <= _options.hashMegabytes * 1024 * 1024) {
+                entries *= 2;
+            }
+            _cache.resize(entries);
+        }
+    }
+    
+    uint64_t run(const Board& board, int depth)
+    {
+        Board position = board;
+        return count(position, std::min(depth, kMaxDepth), 0);
+    }
+    
+    /**
+     * Leaf counts per root move, to narrow down where two move generators disagree.
+     */
+    std::vector<std::pair<typename Board::Move, uint64_t>> divide(const Board& board, int depth)
+    {
+        typename Board::MoveList moves;
+        board.generate(moves);
+        
+        std::vector<std::pair<typename Board::Move, uint64_t>> counts;
+        for (auto&& move : moves) {
+            counts.emplace_back(move, depth > 1 ? run(board.apply(move), depth - 1) : 1);
+        }
+        
+        return counts;
+    }
+    
+    /**
+     * Positions with published perft numbers. For international draughts the initial position and the
+     * Woldouby position, which is full of captures, and for English draughts the initial position.
+     */
+    static std::vector<Reference> references()
+    {
+        if constexpr (std::is_same_v<Variant, International>) {
+            return {
+                {"Initial position", "W:W31-50:B1-20",
+                    {9, 81, 658, 4265, 27117, 167140, 1049442, 6483961, 41022423, 258895763, 1665861398}},
+                {"Woldouby", "W:W25,27,28,30,32,33,34,35,37,38:B12,13,14,16,18,19,21,23,24,26",
+                    {6, 12, 30, 73, 215, 590, 1944, 6269, 22369, 88050, 377436, 1910989, 9872645, 58360286, 346184885}},
+            };
+        } else if constexpr (std::is_same_v<Variant, English>) {
+            return {
+                {"Initial position", "",
+                    {7, 49, 302, 1469, 7361, 36768, 179740, 845931, 3963680, 18391564, 85242128, 388623673}},
+            };
+        } else {
+            return {};
+        }
+    }
+
+private:
+    struct Entry
+    {
+        uint64_t hash{0};
+        uint64_t nodes{0};
+        int depth{0};
+    };
+    
+    uint64_t count(Board& board, int depth, int ply)
+    {
+        if (depth == 0) {
+            return 1;
+        }
+        
+        Entry* entry = nullptr;
+        if (!_cache.empty()) {
+            entry = &_cache[(board.hash ^ static_cast<uint64_t>(depth)) & (_cache.size() - 1)];
+            if (entry->hash == board.hash && entry->depth == depth) {
+                return entry->nodes;
+            }
+        }
+        
+        auto& moves = _moveLists[ply];
+        board.generate(moves);
+        
+        uint64_t nodes = 0;
+        if (depth == 1 && _options.bulk) {
+            nodes = moves.size();
+        } else if (_options.copyMake) {
+            for (auto&& move : moves) {
+                Board next = board.apply(move);
+                nodes += count(next, depth - 1, ply + 1);
+            }
+        } else {
+            for (auto&& move : moves) {
+                typename Board::Undo undo;
+                board.make(move, undo);
+                nodes += count(board, depth - 1, ply + 1);
+                board.unmake(move, undo);
+            }
+        }
+        
+        if (entry) {
+            *entry = Entry{board.hash, nodes, depth};
+        }
+        
+        return nodes;
+    }
+
+private:
+    Options _options;
+    std::vector<typename Board::MoveList> _moveLists;
+    std::vector<Entry> _cache;
+};
+
+using Perft = BasicPerft<International>;
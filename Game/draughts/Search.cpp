@@ -0,0 +1 @@
+#include "Search.hpp"
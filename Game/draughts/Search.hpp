@@ -0,0 +1,679 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "BitBoard.hpp"
+#include "Evaluation.hpp"
+#include "HashHistory.hpp"
+#include "Network.hpp"
+#include "Tablebase.hpp"
+#include "TranspositionTable.hpp"
+
+/**
+ * Negamax alpha-beta search with iterative deepening. Every iteration searches one ply deeper until the
+ * depth limit is reached or the time budget runs out, and the best move of the last completed iteration
+ * is returned. Results are cached in a transposition table that outlives the search, so positions that
+ * are reached again, in this search or in the next turn, don't have to be searched again.
+ */
+class Search
+{
+    struct Ply
+    {
+        BitBoard::MoveList moves;
+        std::array<int32_t, BitBoard::MoveList::kCapacity> scores;
+        std::array<uint8_t, BitBoard::MoveList::kCapacity> order;
+        
+        // Evaluation of the square tables, or the accumulator of the network when there is one, updated by
+        // every move instead of computed at every leaf
+        int32_t accumulated{0};
+        Network::Accumulator network;
+        
+        // Moves are made on a single board, this takes back the move searched from this ply
+        BitBoard::Undo undo;
+    };
+
+public:
+    static constexpr int kMaxPly = 64;
+    static constexpr int32_t kInfinity = 1000000;
+    static constexpr int32_t kWin = 100000;
+    
+    // Tablebase wins are certain but of unknown length, they rank below every win found by searching
+    static constexpr int32_t kTablebaseWin = kWin / 2;
+    
+    struct Result;
+    
+    struct Iteration
+    {
+        int depth{0};
+        int32_t score{0};
+        
+        // Nodes searched in this iteration alone, and the time since the search started when it completed
+        uint64_t nodes{0};
+        std::chrono::milliseconds elapsed{0};
+    };
+    
+    struct Limits
+    {
+        // Zero means no time limit, only the depth limit
+        std::chrono::milliseconds time{50};
+        int depth{kMaxPly - 1};
+        
+        // Zero means no node limit, otherwise searching stops after about this many nodes
+        uint64_t nodes{0};
+        
+        // Searching stops as soon as this flag is raised
+        const std::atomic<bool>* stop{nullptr};
+        
+        // While this flag is raised the time limit doesn't apply, for thinking on the opponent's time
+        const std::atomic<bool>* pondering{nullptr};
+        
+        // Called after every completed iteration with the best move so far
+        std::function<void(const Result&)> progress;
+    };
+    
+    struct Result
+    {
+        BitBoard::Move move;
+        int32_t score{0};
+        
+        // Deepest completed iteration, 0 when even the first one was cut short
+        int depth{0};
+        uint64_t nodes{0};
+        
+        // Nodes searched past the nominal depth to play out captures
+        uint64_t qnodes{0};
+        std::chrono::milliseconds elapsed{0};
+        
+        // Beta cutoffs, and how many of them were caused by the first move searched
+        uint64_t cutoffs{0};
+        uint64_t firstMoveCutoffs{0};
+        
+        // The same by the remaining depth of the node they happened in, quiescence nodes don't cut off
+        std::vector<uint64_t> cutoffsByDepth;
+        std::vector<uint64_t> firstMoveCutoffsByDepth;
+        
+        // Lookups in the transposition table and the tablebase, and how many of them found the position
+        uint64_t tableProbes{0};
+        uint64_t tableHits{0};
+        uint64_t tablebaseProbes{0};
+        uint64_t tablebaseHits{0};
+        
+        // Completed iterations, the last one gave the move
+        std::vector<Iteration> iterations;
+        
+        // Expected line of play starting with the move, followed through the transposition table
+        std::vector<BitBoard::Move> principalVariation;
+        
+        // Played from the opening book without searching
+        bool fromBook{false};
+        
+        /**
+         * Share of the cutoffs caused by the first move, the closer to one the better the move ordering.
+         */
+        double firstMoveCutoffRate() const
+        {
+            return cutoffs > 0 ? static_cast<double>(firstMoveCutoffs) / cutoffs : 0;
+        }
+        
+        double tableHitRate() const
+        {
+            return tableProbes > 0 ? static_cast<double>(tableHits) / tableProbes : 0;
+        }
+        
+        uint64_t nodesPerSecond() const
+        {
+            return (nodes + qnodes) * 1000 / std::max<int64_t>(elapsed.count(), 1);
+        }
+        
+        /**
+         * Growth of the nodes from the second to last to the last iteration, how many times more an
+         * iteration costs than the one before. Zero until there are two iterations.
+         */
+        double effectiveBranchingFactor() const
+        {
+            if (iterations.size() < 2 || iterations[iterations.size() - 2].nodes == 0) {
+                return 0;
+            }
+            
+            return static_cast<double>(iterations.back().nodes) / iterations[iterations.size() - 2].nodes;
+        }
+    };
+
+public:
+    Search(std::shared_ptr<TranspositionTable> table)
+        : _plies(kMaxPly)
+        , _table(table)
+    {
+        clearHistory();
+    }
+    
+    Result run(const BitBoard& board, Limits limits, int firstDepth = 1)
+    {
+        return run(board, HashHistory(board), limits, firstDepth);
+    }
+    
+    /**
+     * Searches the position from `firstDepth` on, helper threads of a parallel search start at different
+     * depths so they don't all search the same tree at the same time. `positions` are the positions of the
+     * game up to this one, moves repeating them are draws.
+     */
+    Result run(const BitBoard& board, const HashHistory& positions, Limits limits, int firstDepth = 1)
+    {
+        assert(positions.hash() == board.hash);
+        
+        // Deeper searches would run out of plies and of the statistics by depth
+        limits.depth = std::min(limits.depth, kMaxPly - 1);
+        
+        _start = std::chrono::steady_clock::now();
+        _deadline = limits.time.count() > 0 ? _start + limits.time : std::chrono::steady_clock::time_point::max();
+        _externalStop = limits.stop;
+        _pondering = limits.pondering;
+        _nodeLimit = limits.nodes;
+        _nodes = 0;
+        _qnodes = 0;
+        _cutoffs = 0;
+        _firstMoveCutoffs = 0;
+        _cutoffsByDepth.fill(0);
+        _firstMoveCutoffsByDepth.fill(0);
+        _tableProbes = 0;
+        _tableHits = 0;
+        _tablebaseProbes = 0;
+        _tablebaseHits = 0;
+        _stopped = false;
+        
+        for (auto&& killers : _killers) {
+            killers.fill(BitBoard::Move());
+        }
+        
+        // Let the history of earlier searches fade instead of starting over
+        for (auto&& fromHistory : _history) {
+            for (auto&& toHistory : fromHistory) {
+                for (auto&& history : toHistory) {
+                    history /= 2;
+                }
+            }
+        }
+        
+        _positions = positions;
+        
+        Result result;
+        if (_network) {
+            _network->refresh(board, _plies[0].network);
+        } else {
+            _plies[0].accumulated = _evaluation.accumulate(board);
+        }
+        auto& rootMoves = _plies[0].moves;
+        board.generate(rootMoves);
+        if (rootMoves.empty()) {
+            result.score = -kWin;
+            return result;
+        }
+        
+        result.move = rootMoves[0];
+        if (rootMoves.size() == 1) {
+            return finish(board, result);
+        }
+        
+        BitBoard position = board;
+        uint64_t searched = 0;
+        for (int depth = firstDepth; depth <= limits.depth; ++depth) {
+            BitBoard::Move bestMove;
+            int32_t score = searchRoot(position, depth, result.move, bestMove);
+            
+            // An interrupted iteration is incomplete and can't be trusted, except for the root moves the first
+            // one finished, which are still better than no search at all. Those aren't a completed iteration
+            // though, so the depth stays 0 and nothing is reported.
+            if (_stopped) {
+                if (depth == firstDepth && score != -kInfinity) {
+                    result.move = bestMove;
+                    result.score = score;
+                }
+                break;
+            }
+            
+            result.move = bestMove;
+            result.score = score;
+            result.depth = depth;
+            
+            Iteration iteration;
+            iteration.depth = depth;
+            iteration.score = score;
+            iteration.nodes = _nodes + _qnodes - searched;
+            iteration.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - _start);
+            result.iterations.push_back(iteration);
+            searched = _nodes + _qnodes;
+            
+            if (limits.progress) {
+                Result progress = result;
+                limits.progress(finish(board, progress));
+            }
+            
+            // No need to search deeper once a forced win or loss is found
+            if (std::abs(score) >= kWin - kMaxPly) {
+                break;
+            }
+        }
+        
+        return finish(board, result);
+    }
+    
+    void stop()
+    {
+        _stopped = true;
+    }
+    
+    void setEvaluation(const Evaluation& evaluation)
+    {
+        _evaluation = evaluation;
+    }
+    
+    void setTablebase(std::shared_ptr<const Tablebase> tablebase)
+    {
+        _tablebase = tablebase;
+    }
+    
+    /**
+     * Evaluates positions with the network instead of the square tables, or with the square tables again
+     * when null.
+     */
+    void setNetwork(std::shared_ptr<const Network> network)
+    {
+        _network = network;
+    }
+    
+    void clearHistory()
+    {
+        for (auto&& fromHistory : _history) {
+            for (auto&& toHistory : fromHistory) {
+                toHistory.fill(0);
+            }
+        }
+    }
+
+private:
+    Result finish(const BitBoard& board, Result& result)
+    {
+        result.nodes = _nodes;
+        result.qnodes = _qnodes;
+        result.cutoffs = _cutoffs;
+        result.firstMoveCutoffs = _firstMoveCutoffs;
+        result.tableProbes = _tableProbes;
+        result.tableHits = _tableHits;
+        result.tablebaseProbes = _tablebaseProbes;
+        result.tablebaseHits = _tablebaseHits;
+        result.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - _start);
+        
+        size_t depths = _cutoffsByDepth.size();
+        while (depths > 0 && _cutoffsByDepth[depths - 1] == 0) {
+            --depths;
+        }
+        result.cutoffsByDepth.assign(_cutoffsByDepth.begin(), _cutoffsByDepth.begin() + depths);
+        result.firstMoveCutoffsByDepth.assign(_firstMoveCutoffsByDepth.begin(), _firstMoveCutoffsByDepth.begin() + depths);
+        
+        result.principalVariation = principalVariation(board, result.move, std::max(result.depth, 1));
+        return result;
+    }
+    
+    /**
+     * The move followed by the best moves stored in the transposition table, at most `length` moves. The
+     * line ends early where a position is missing from the table or was overwritten.
+     */
+    std::vector<BitBoard::Move> principalVariation(BitBoard board, const BitBoard::Move& move, int length) const
+    {
+        std::vector<BitBoard::Move> line{move};
+        board = board.apply(move);
+        
+        BitBoard::MoveList moves;
+        TranspositionTable::Entry entry;
+        while (static_cast<int>(line.size()) < length && _table->probe(board.hash, entry)) {
+            board.generate(moves);
+            if (entry.move >= moves.size()) {
+                break;
+            }
+            
+            line.push_back(moves[entry.move]);
+            board = board.apply(moves[entry.move]);
+        }
+        
+        return line;
+    }
+    
+    int32_t searchRoot(BitBoard& board, int depth, const BitBoard::Move& previousBest, BitBoard::Move& bestMove)
+    {
+        // The root moves are generated once per search, try the best move of the previous iteration first
+        auto& moves = _plies[0].moves;
+        std::iter_swap(moves.begin(), std::find(moves.begin(), moves.end(), previousBest));
+        
+        int32_t alpha = -kInfinity;
+        for (auto&& move : moves) {
+            make(board, 0, move);
+            int32_t score = -negamax(board, depth - 1, 1, -kInfinity, -alpha);
+            unmake(board, 0, move);
+            
+            // The score of a move whose search was cut short is whatever was returned when it stopped
+            if (_stopped) {
+                break;
+            }
+            
+            if (score > alpha) {
+                alpha = score;
+                bestMove = move;
+            }
+        }
+        
+        return alpha;
+    }
+    
+    int32_t negamax(BitBoard& board, int depth, int ply, int32_t alpha, int32_t beta)
+    {
+        // A position seen before is scored as a draw already at its first repetition, whoever wants more
+        // than a draw has to avoid it anyway, and there is no point searching it twice
+        if (_positions.repeated() || _positions.reversible() >= BitBoard::kDrawPlies) {
+            return 0;
+        }
+        
+        if (depth <= 0) {
+            return quiescence(board, ply, alpha, beta);
+        }
+        
+        if ((++_nodes & 1023) == 0) {
+            checkStop();
+        }
+        
+        if (ply >= kMaxPly - 1) {
+            return evaluate(board, ply);
+        }
+        
+        int32_t tablebaseScore;
+        if (probeTablebase(board, ply, tablebaseScore)) {
+            return tablebaseScore;
+        }
+        
+        uint8_t hashMove = TranspositionTable::kNoMove;
+        TranspositionTable::Entry entry;
+        ++_tableProbes;
+        if (_table->probe(board.hash, entry)) {
+            ++_tableHits;
+            hashMove = entry.move;
+            
+            int32_t score = fromTable(entry.score, ply);
+            if (entry.depth >= depth) {
+                if (entry.bound == TranspositionTable::Bound::Exact
+                 || (entry.bound == TranspositionTable::Bound::Lower && score >= beta)
+                 || (entry.bound == TranspositionTable::Bound::Upper && score <= alpha)) {
+                    return score;
+                }
+            }
+        }
+        
+        auto& moves = _plies[ply].moves;
+        board.generate(moves);
+        
+        // Not being able to move loses the game, prefer the longest way to lose and the shortest way to win
+        if (moves.empty()) {
+            return -kWin + ply;
+        }
+        
+        // Search the cached best move first, then captures, then the quiet moves that caused a cutoff in a
+        // sibling position, and finally the other quiet moves by how often they caused a cutoff before
+        auto& scores = _plies[ply].scores;
+        const auto& killers = _killers[ply];
+        for (size_t i = 0; i < moves.size(); ++i) {
+            const auto& move = moves[i];
+            if (i == hashMove) {
+                scores[i] = kHashMoveScore;
+            } else if (move.captures > 0) {
+                scores[i] = kCaptureScore + move.captures * 2 + BitBoard::popcount(move.captured & board.kings);
+            } else if (move == killers[0]) {
+                scores[i] = kKillerScore;
+            } else if (move == killers[1]) {
+                scores[i] = kKillerScore - 1;
+            } else {
+                scores[i] = history(board.turn, move);
+            }
+        }
+        
+        int32_t originalAlpha = alpha;
+        int32_t best = -kInfinity;
+        uint8_t bestMove = TranspositionTable::kNoMove;
+        for (size_t i = 0; i < moves.size(); ++i) {
+            size_t index = nextMove(_plies[ply], i);
+            make(board, ply, moves[index]);
+            int32_t score = -negamax(board, depth - 1, ply + 1, -beta, -alpha);
+            unmake(board, ply, moves[index]);
+            if (_stopped) {
+                return 0;
+            }
+            
+            if (score > best) {
+                best = score;
+                bestMove = static_cast<uint8_t>(index);
+                alpha = std::max(alpha, score);
+                if (alpha >= beta) {
+                    ++_cutoffs;
+                    _firstMoveCutoffs += i == 0;
+                    ++_cutoffsByDepth[depth];
+                    _firstMoveCutoffsByDepth[depth] += i == 0;
+                    if (moves[index].captures == 0) {
+                        auto& moveHistory = history(board.turn, moves[index]);
+                        moveHistory = std::min(moveHistory + depth * depth, kMaxHistory);
+                        storeKiller(ply, moves[index]);
+                    }
+                    break;
+                }
+            }
+        }
+        
+        TranspositionTable::Bound bound = best >= beta ? TranspositionTable::Bound::Lower
+                                        : best > originalAlpha ? TranspositionTable::Bound::Exact
+                                                               : TranspositionTable::Bound::Upper;
+        _table->store(board.hash, depth, toTable(best, ply), bound, bestMove);
+        return best;
+    }
+    
+    /**
+     * Makes the move on the board and brings the evaluation of the next ply and the positions played up to
+     * date.
+     */
+    void make(BitBoard& board, int ply, const BitBoard::Move& move)
+    {
+        bool irreversible = HashHistory::irreversible(board, move);
+        board.make(move, _plies[ply].undo);
+        _positions.push(board.hash, irreversible);
+        if (_network) {
+            _network->update(board, _plies[ply].undo, move, _plies[ply].network, _plies[ply + 1].network);
+        } else {
+            _plies[ply + 1].accumulated = _plies[ply].accumulated + _evaluation.update(board, _plies[ply].undo, move);
+        }
+    }
+    
+    void unmake(BitBoard& board, int ply, const BitBoard::Move& move)
+    {
+        board.unmake(move, _plies[ply].undo);
+        _positions.pop();
+    }
+    
+    int32_t evaluate(const BitBoard& board, int ply) const
+    {
+        return _network ? _network->evaluate(board, _plies[ply].network) : _evaluation.evaluate(board, _plies[ply].accumulated);
+    }
+    
+    /**
+     * Keeps searching past the nominal depth as long as the side to move has to capture, so a position in
+     * the middle of an exchange is never evaluated as if it were quiet. Because captures are mandatory there
+     * is no standing pat, only positions without captures are evaluated.
+     */
+    int32_t quiescence(BitBoard& board, int ply, int32_t alpha, int32_t beta)
+    {
+        if ((++_qnodes & 1023) == 0) {
+            checkStop();
+        }
+        
+        int32_t tablebaseScore;
+        if (probeTablebase(board, ply, tablebaseScore)) {
+            return tablebaseScore;
+        }
+        
+        auto& moves = _plies[ply].moves;
+        board.generate(moves);
+        if (moves.empty()) {
+            return -kWin + ply;
+        }
+        
+        if (moves[0].captures == 0 || ply >= kMaxPly - 1) {
+            return evaluate(board, ply);
+        }
+        
+        int32_t best = -kInfinity;
+        for (auto&& move : moves) {
+            make(board, ply, move);
+            int32_t score = -quiescence(board, ply + 1, -beta, -alpha);
+            unmake(board, ply, move);
+            if (_stopped) {
+                return 0;
+            }
+            
+            if (score > best) {
+                best = score;
+                alpha = std::max(alpha, score);
+                if (alpha >= beta) {
+                    break;
+                }
+            }
+        }
+        
+        return best;
+    }
+    
+    /**
+     * Exact outcome of positions with few enough pieces. Wins and losses keep the evaluation on top, so the
+     * winning side still prefers positions that make progress, like promoting or trading down.
+     */
+    bool probeTablebase(const BitBoard& board, int ply, int32_t& score)
+    {
+        if (!_tablebase || BitBoard::popcount(board.white | board.black) > _tablebase->pieces()) {
+            return false;
+        }
+        
+        Tablebase::Value value;
+        ++_tablebaseProbes;
+        if (!_tablebase->probe(board, value)) {
+            return false;
+        }
+        
+        ++_tablebaseHits;
+        int32_t evaluation = std::clamp(evaluate(board, ply), -kTablebaseWin / 2, kTablebaseWin / 2);
+        score = value == Tablebase::Value::Win ? kTablebaseWin + evaluation
+              : value == Tablebase::Value::Loss ? -kTablebaseWin + evaluation
+                                                : 0;
+        return true;
+    }
+    
+    void checkStop()
+    {
+        bool outOfTime = std::chrono::steady_clock::now() >= _deadline && !(_pondering && *_pondering);
+        if (outOfTime || (_externalStop && *_externalStop)
+         || (_nodeLimit > 0 && _nodes + _qnodes >= _nodeLimit)) {
+            _stopped = true;
+        }
+    }
+    
+    /**
+     * Index of the best scored move not searched yet. The order is kept next to the move list, so indices
+     * into the list stay the same as the generated order stored in the transposition table.
+     */
+    static size_t nextMove(Ply& ply, size_t searched)
+    {
+        if (searched == 0) {
+            for (size_t i = 0; i < ply.moves.size(); ++i) {
+                ply.order[i] = static_cast<uint8_t>(i);
+            }
+        }
+        
+        size_t best = searched;
+        for (size_t i = searched + 1; i < ply.moves.size(); ++i) {
+            if (ply.scores[ply.order[i]] > ply.scores[ply.order[best]]) {
+                best = i;
+            }
+        }
+        
+        std::swap(ply.order[searched], ply.order[best]);
+        return ply.order[searched];
+    }
+    
+    void storeKiller(int ply, const BitBoard::Move& move)
+    {
+        auto& killers = _killers[ply];
+        if (killers[0] != move) {
+            killers[1] = killers[0];
+            killers[0] = move;
+        }
+    }
+    
+    int32_t& history(BitBoard::Color turn, const BitBoard::Move& move)
+    {
+        return _history[static_cast<int>(turn)][move.from][move.to];
+    }
+    
+    // Win and loss scores are stored relative to the position instead of the root
+    static int32_t toTable(int32_t score, int ply)
+    {
+        return score >= kWin - kMaxPly ? score + ply : score <= -kWin + kMaxPly ? score - ply : score;
+    }
+    
+    static int32_t fromTable(int32_t score, int ply)
+    {
+        return score >= kWin - kMaxPly ? score - ply : score <= -kWin + kMaxPly ? score + ply : score;
+    }
+
+private:
+    static constexpr int32_t kMaxHistory = 1 << 30;
+    
+    // Move ordering stages, history scores of quiet moves stay below the killers
+    static constexpr int32_t kHashMoveScore = INT32_MAX;
+    static constexpr int32_t kCaptureScore = kHashMoveScore - 1024;
+    static constexpr int32_t kKillerScore = kMaxHistory + 2;
+    
+    // One move list per ply, allocated once so searching doesn't touch the heap or the thread's stack
+    std::vector<Ply> _plies;
+    std::shared_ptr<TranspositionTable> _table;
+    Evaluation _evaluation;
+    std::shared_ptr<const Network> _network;
+    std::shared_ptr<const Tablebase> _tablebase;
+    
+    // Positions of the game and of the line being searched, for recognizing repetitions
+    HashHistory _positions;
+    static_assert(HashHistory::kCapacity > BitBoard::kDrawPlies + kMaxPly, "the positions have to fit the game and the search");
+    
+    // Quiet moves by side, from and to square which caused cutoffs, weighted by depth
+    std::array<std::array<std::array<int32_t, BitBoard::kSquares>, BitBoard::kSquares>, 2> _history;
+    
+    // Last two quiet moves per ply that caused a cutoff
+    std::array<std::array<BitBoard::Move, 2>, kMaxPly> _killers;
+    
+    std::chrono::steady_clock::time_point _start;
+    std::chrono::steady_clock::time_point _deadline;
+    const std::atomic<bool>* _externalStop{nullptr};
+    const std::atomic<bool>* _pondering{nullptr};
+    uint64_t _nodeLimit{0};
+    std::atomic<bool> _stopped{false};
+    uint64_t _nodes{0};
+    uint64_t _qnodes{0};
+    uint64_t _cutoffs{0};
+    uint64_t _firstMoveCutoffs{0};
+    std::array<uint64_t, kMaxPly> _cutoffsByDepth{};
+    std::array<uint64_t, kMaxPly> _firstMoveCutoffsByDepth{};
+    uint64_t _tableProbes{0};
+    uint64_t _tableHits{0};
+    uint64_t _tablebaseProbes{0};
+    uint64_t _tablebaseHits{0};
+};
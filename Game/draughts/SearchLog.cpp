@@ -0,0 +1 @@
+#include "SearchLog.hpp"
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Notation.hpp"
+#include "ParallelSearch.hpp"
+#include "Search.hpp"
+
+/**
+ * Search statistics written as JSON lines, one object per search, so the cost of searches can be compared
+ * between versions and settings with any tool that reads JSON.
+ */
+class SearchLog
+{
+public:
+    /**
+     * Appends to the file, so several runs can share one log.
+     */
+    SearchLog(const std::string& path)
+        : _file(path, std::ios::app)
+    {
+        if (!_file) {
+            throw std::runtime_error("can't write search log " + path);
+        }
+    }
+    
+    /**
+     * Writes one JSON object as a line, safe to call from several threads.
+     */
+    void write(const std::string& object)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _file << object << std::endl;
+    }
+    
+    static std::string json(const Search::Result& result)
+    {
+        std::ostringstream json;
+        json << "{\"move\":\"" << Notation::move(result.move) << "\""
+             << ",\"score\":" << result.score
+             << ",\"depth\":" << result.depth
+             << ",\"nodes\":" << result.nodes
+             << ",\"qnodes\":" << result.qnodes
+             << ",\"milliseconds\":" << result.elapsed.count()
+             << ",\"nodesPerSecond\":" << result.nodesPerSecond()
+             << ",\"effectiveBranchingFactor\":" << result.effectiveBranchingFactor()
+             << ",\"tableProbes\":" << result.tableProbes
+             << ",\"tableHits\":" << result.tableHits
+             << ",\"tablebaseProbes\":" << result.tablebaseProbes
+             << ",\"tablebaseHits\":" << result.tablebaseHits
+             << ",\"cutoffs\":" << result.cutoffs
+             << ",\"firstMoveCutoffs\":" << result.firstMoveCutoffs
+             << ",\"cutoffsByDepth\":" << array(result.cutoffsByDepth)
+             << ",\"firstMoveCutoffsByDepth\":" << array(result.firstMoveCutoffsByDepth)
+             << ",\"fromBook\":" << (result.fromBook ? "true" : "false");
+        
+        json << ",\"iterations\":[";
+        for (size_t i = 0; i < result.iterations.size(); ++i) {
+            const auto& iteration = result.iterations[i];
+            json << (i > 0 ? "," : "") << "{\"depth\":" << iteration.depth << ",\"score\":" << iteration.score
+                 << ",\"nodes\":" << iteration.nodes << ",\"milliseconds\":" << iteration.elapsed.count() << "}";
+        }
+        
+        json << "],\"principalVariation\":[";
+        for (size_t i = 0; i < result.principalVariation.size(); ++i) {
+            json << (i > 0 ? "," : "") << "\"" << Notation::move(result.principalVariation[i]) << "\"";
+        }
+        json << "]}";
+        
+        return json.str();
+    }
+    
+    /**
+     * The result of the main thread, with the depth and speed of every thread added.
+     */
+    static std::string json(const ParallelSearch::Result& result)
+    {
+        std::string json = SearchLog::json(result.best);
+        json.pop_back();
+        
+        std::ostringstream threads;
+        threads << ",\"threads\":[";
+        for (size_t i = 0; i < result.threads.size(); ++i) {
+            threads << (i > 0 ? "," : "") << "{\"depth\":" << result.threads[i].depth << ",\"nodes\":" << result.threads[i].nodes
+                    << ",\"nodesPerSecond\":" << result.threads[i].nodesPerSecond << "}";
+        }
+        threads << "]}";
+        
+        return json + threads.str();
+    }
+
+private:
+    static std::string array(const std::vector<uint64_t>& values)
+    {
+        std::ostringstream json;
+        json << "[";
+        for (size_t i = 0; i < values.size(); ++i) {
+            json << (i > 0 ? "," : "") << values[i];
+        }
+        json << "]";
+        return json.str();
+    }
+
+private:
+    std::ofstream _file;
+    std::mutex _mutex;
+};
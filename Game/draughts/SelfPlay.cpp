@@ -0,0 +1 @@
+#include "SelfPlay.hpp"
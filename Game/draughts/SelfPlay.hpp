@@ -0,0 +1,241 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Ai.hpp"
+#include "BitBoard.hpp"
+#include "GameState.hpp"
+#include "Search.hpp"
+
+/**
+ * Plays games between two computer players, many at the same time, to measure whether a change makes the
+ * engine stronger or weaker. Games are played in pairs from the same random opening with the colors
+ * swapped, so neither player profits from a lucky opening.
+ */
+class SelfPlay
+{
+public:
+    struct Player
+    {
+        std::string name;
+        Search::Limits limits;
+        size_t hashMegabytes{16};
+        
+        // Evaluation weights file, the default weights when empty
+        std::string weights;
+        
+        // Network file evaluating instead of the weights when not empty
+        std::string network;
+        
+        Ai::Engine engine{Ai::Engine::AlphaBeta};
+    };
+    
+    struct Options
+    {
+        size_t games{100};
+        size_t threads{std::max(1u, std::thread::hardware_concurrency())};
+        
+        // Random moves played before the players take over
+        int openingPlies{4};
+        
+        // Games still going on after this many plies are adjudicated as a draw
+        int maxPlies{300};
+        
+        uint64_t seed{1};
+    };
+    
+    enum class Outcome
+    {
+        FirstWins,
+        SecondWins,
+        Draw
+    };
+    
+    struct PlayedMove
+    {
+        // Position the move was played in
+        BitBoard board;
+        BitBoard::Move move;
+        
+        // Whether the move was played by the first player, moves of the random opening have no search
+        bool first{false};
+        bool opening{false};
+        Search::Result search;
+    };
+    
+    struct Game
+    {
+        size_t index{0};
+        bool firstIsWhite{true};
+        std::vector<PlayedMove> moves;
+        Outcome outcome{Outcome::Draw};
+    };
+    
+    /**
+     * Wins, draws and losses of the first player, with the Elo difference they imply.
+     */
+    struct Score
+    {
+        size_t wins{0};
+        size_t draws{0};
+        size_t losses{0};
+        
+        size_t games() const
+        {
+            return wins + draws + losses;
+        }
+        
+        double ratio() const
+        {
+            return games() > 0 ? (wins + 0.5 * draws) / games() : 0.5;
+        }
+        
+        double elo() const
+        {
+            return toElo(ratio());
+        }
+        
+        /**
+         * Half the width of the 95% confidence interval of the Elo difference.
+         */
+        double eloMargin() const
+        {
+            if (games() == 0) {
+                return 0;
+            }
+            
+            double ratio = this->ratio();
+            double variance = (wins * std::pow(1 - ratio, 2) + draws * std::pow(0.5 - ratio, 2) + losses * std::pow(ratio, 2)) / games();
+            double margin = 1.96 * std::sqrt(variance / games());
+            return (toElo(ratio + margin) - toElo(ratio - margin)) / 2;
+        }
+    
+    private:
+        static double toElo(double ratio)
+        {
+            ratio = std::clamp(ratio, 1e-6, 1 - 1e-6);
+            return 400 * std::log10(ratio / (1 - ratio));
+        }
+    };
+
+public:
+    SelfPlay(Player first, Player second, Options options)
+        : _first(first)
+        , _second(second)
+        , _options(options)
+    {
+    
+    }
+    
+    /**
+     * Plays all games, calling `onGame` for every finished game. The callback is never called from two
+     * threads at the same time.
+     */
+    Score run(std::function<void(const Game&)> onGame = nullptr)
+    {
+        Score score;
+        std::atomic<size_t> next{0};
+        std::mutex mutex;
+        
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < std::max<size_t>(_options.threads, 1); ++i) {
+            workers.emplace_back([&]() {
+                Ai first(_first.limits.time, _first.hashMegabytes, 1);
+                Ai second(_second.limits.time, _second.hashMegabytes, 1);
+                first.limits() = _first.limits;
+                second.limits() = _second.limits;
+                first.setEngine(_first.engine);
+                second.setEngine(_second.engine);
+                if (!_first.weights.empty()) {
+                    first.loadWeights(_first.weights);
+                }
+                if (!_second.weights.empty()) {
+                    second.loadWeights(_second.weights);
+                }
+                if (!_first.network.empty()) {
+                    first.loadNetwork(_first.network);
+                }
+                if (!_second.network.empty()) {
+                    second.loadNetwork(_second.network);
+                }
+                
+                for (size_t index = next++; index < _options.games; index = next++) {
+                    Game game = play(index, first, second);
+                    
+                    std::lock_guard<std::mutex> lock(mutex);
+                    score.wins += game.outcome == Outcome::FirstWins;
+                    score.draws += game.outcome == Outcome::Draw;
+                    score.losses += game.outcome == Outcome::SecondWins;
+                    if (onGame) {
+                        onGame(game);
+                    }
+                }
+            });
+        }
+        
+        for (auto&& worker : workers) {
+            worker.join();
+        }
+        
+        return score;
+    }
+
+private:
+    Game play(size_t index, Ai& first, Ai& second)
+    {
+        first.clear();
+        second.clear();
+        
+        Game game;
+        game.index = index;
+        game.firstIsWhite = index % 2 == 0;
+        
+        GameState state;
+        
+        // Both games of a pair share the same seed and so the same opening
+        std::mt19937_64 random(_options.seed + index / 2);
+        for (int ply = 0; ply < _options.openingPlies && state.result() == GameState::Result::Ongoing; ++ply) {
+            const auto& moves = state.legalMoves();
+            PlayedMove played;
+            played.board = state.board();
+            played.move = moves[random() % moves.size()];
+            played.opening = true;
+            state.play(played.move);
+            game.moves.emplace_back(played);
+        }
+        
+        while (state.result() == GameState::Result::Ongoing && static_cast<int>(game.moves.size()) < _options.maxPlies) {
+            PlayedMove played;
+            played.board = state.board();
+            played.first = (state.turn() == BitBoard::Color::White) == game.firstIsWhite;
+            played.search = (played.first ? first : second).findOptimalMove(state.board(), state.positions()).best;
+            played.move = played.search.move;
+            state.play(played.move);
+            game.moves.emplace_back(played);
+        }
+        
+        // Games still going after the most plies are adjudicated as a draw as well
+        if (state.result() == GameState::Result::Ongoing || state.result() == GameState::Result::Draw) {
+            game.outcome = Outcome::Draw;
+        } else {
+            bool whiteWins = state.result() == GameState::Result::WhiteWins;
+            game.outcome = whiteWins == game.firstIsWhite ? Outcome::FirstWins : Outcome::SecondWins;
+        }
+        
+        return game;
+    }
+
+private:
+    Player _first;
+    Player _second;
+    Options _options;
+};
@@ -0,0 +1 @@
+#include "SessionHost.hpp"
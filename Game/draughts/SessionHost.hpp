@@ -0,0 +1,291 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "BitBoard.hpp"
+#include "Evaluation.hpp"
+#include "GameState.hpp"
+#include "HashHistory.hpp"
+#include "OpeningBook.hpp"
+#include "Search.hpp"
+#include "Tablebase.hpp"
+#include "ThreadPool.hpp"
+#include "TranspositionTable.hpp"
+
+/**
+ * Hosts many games at once, each played by a client against the computer. The games only hold the rules
+ * side, nothing is rendered. The searches of all games run on one shared thread pool instead of a thread
+ * per game, and share the evaluation, tablebase and opening book.
+ *
+ * Every game has its own time budget per move, counted from when the move is asked for. A search that had
+ * to wait for a free thread gets what is left of the budget, so under load every game still gets its moves
+ * in time and no game can hold up the others by searching longer. A game has at most one search at a time.
+ */
+class SessionHost
+{
+public:
+    using SessionId = uint64_t;
+    
+    struct Options
+    {
+        size_t threads{std::max(1u, std::thread::hardware_concurrency())};
+        
+        // Transposition table size per game
+        size_t hashMegabytes{4};
+        
+        // Default budget of the games, the time limit counts from when a move is asked for
+        Search::Limits limits;
+        
+        Evaluation evaluation;
+        std::shared_ptr<const Tablebase> tablebase;
+        std::shared_ptr<const OpeningBook> book;
+    };
+    
+    /**
+     * The computer's move, already played in the game.
+     */
+    struct Reply
+    {
+        BitBoard::Move move;
+        Search::Result search;
+        
+        // Time spent waiting for a free thread, and from asking for the move until it was played
+        std::chrono::microseconds queued{0};
+        std::chrono::microseconds latency{0};
+    };
+
+public:
+    SessionHost()
+        : SessionHost(Options())
+    {
+    
+    }
+    
+    SessionHost(const Options& options)
+        : _options(options)
+        , _pool(options.threads)
+    {
+    
+    }
+    
+    /**
+     * Stops the searches of all games. The pool goes first and waits for them before anything they use
+     * is destroyed.
+     */
+    ~SessionHost()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (auto&& [id, session] : _sessions) {
+            session->stop = true;
+        }
+    }
+    
+    /**
+     * Starts a game from the initial position with the default budget.
+     */
+    SessionId open()
+    {
+        return open(_options.limits);
+    }
+    
+    SessionId open(const Search::Limits& limits)
+    {
+        auto session = std::make_shared<Session>(_options, limits);
+        std::lock_guard<std::mutex> lock(_mutex);
+        session->random.seed(_nextId);
+        _sessions.emplace(_nextId, session);
+        return _nextId++;
+    }
+    
+    /**
+     * Ends a game, its search is stopped and still answered.
+     */
+    void close(SessionId id)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto found = _sessions.find(id);
+        if (found != _sessions.end()) {
+            found->second->stop = true;
+            _sessions.erase(found);
+        }
+    }
+    
+    /**
+     * Starts the game over from the initial position, forgetting what its searches learned.
+     */
+    void restart(SessionId id)
+    {
+        auto session = find(id);
+        std::lock_guard<std::mutex> lock(session->mutex);
+        if (session->searching) {
+            throw std::runtime_error("can't restart a game while the computer is thinking");
+        }
+        
+        session->game = GameState();
+        session->table->clear();
+        session->search.clearHistory();
+    }
+    
+    /**
+     * Plays the client's move. Returns false when the move is illegal or the computer is thinking.
+     */
+    bool play(SessionId id, const BitBoard::Move& move)
+    {
+        auto session = find(id);
+        std::lock_guard<std::mutex> lock(session->mutex);
+        return !session->searching && session->game.play(move);
+    }
+    
+    /**
+     * Copy of the game, safe to look at while the computer is thinking.
+     */
+    GameState state(SessionId id) const
+    {
+        auto session = find(id);
+        std::lock_guard<std::mutex> lock(session->mutex);
+        return session->game;
+    }
+    
+    /**
+     * Lets the computer move for the side to move. The search is queued on the pool and the move played
+     * once it is done. When the move can't be played the future throws instead, the game is left as it
+     * was and the move can be asked for again.
+     */
+    std::future<Reply> requestMove(SessionId id)
+    {
+        auto session = find(id);
+        std::lock_guard<std::mutex> lock(session->mutex);
+        if (session->searching) {
+            throw std::runtime_error("the computer is already thinking");
+        }
+        if (session->game.result() != GameState::Result::Ongoing) {
+            throw std::runtime_error("the game is over");
+        }
+        
+        session->searching = true;
+        auto promise = std::make_shared<std::promise<Reply>>();
+        auto future = promise->get_future();
+        auto requested = std::chrono::steady_clock::now();
+        _pool.submit([this, session, promise, requested]() {
+            try {
+                promise->set_value(think(*session, requested));
+            } catch (...) {
+                promise->set_exception(std::current_exception());
+            }
+        });
+        
+        return future;
+    }
+    
+    size_t sessions() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _sessions.size();
+    }
+    
+    const ThreadPool& pool() const
+    {
+        return _pool;
+    }
+
+private:
+    struct Session
+    {
+        Session(const Options& options, const Search::Limits& limits)
+            : table(std::make_shared<TranspositionTable>(options.hashMegabytes))
+            , search(table)
+            , limits(limits)
+        {
+            search.setEvaluation(options.evaluation);
+            search.setTablebase(options.tablebase);
+        }
+        
+        // Guards the game and whether a search is running, the search itself runs outside of it
+        std::mutex mutex;
+        GameState game;
+        bool searching{false};
+        
+        std::shared_ptr<TranspositionTable> table;
+        Search search;
+        Search::Limits limits;
+        std::atomic<bool> stop{false};
+        
+        // Picks between book moves
+        std::mt19937_64 random;
+    };
+    
+    // Least time a search gets however long it waited, a time of zero would mean no time limit at all
+    static constexpr std::chrono::milliseconds kMinimumTime{1};
+
+private:
+    std::shared_ptr<Session> find(SessionId id) const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto found = _sessions.find(id);
+        if (found == _sessions.end()) {
+            throw std::runtime_error("no game with id " + std::to_string(id));
+        }
+        
+        return found->second;
+    }
+    
+    Reply think(Session& session, std::chrono::steady_clock::time_point requested)
+    {
+        auto started = std::chrono::steady_clock::now();
+        BitBoard board;
+        HashHistory positions;
+        {
+            std::lock_guard<std::mutex> lock(session.mutex);
+            board = session.game.board();
+            positions = session.game.positions();
+        }
+        
+        Reply reply;
+        reply.queued = std::chrono::duration_cast<std::chrono::microseconds>(started - requested);
+        if (_options.book && _options.book->pick(board, reply.move, session.random)) {
+            reply.search.move = reply.move;
+            reply.search.fromBook = true;
+        } else {
+            Search::Limits limits = session.limits;
+            limits.stop = &session.stop;
+            if (limits.time.count() > 0) {
+                auto waited = std::chrono::duration_cast<std::chrono::milliseconds>(started - requested);
+                limits.time = std::max(limits.time - waited, kMinimumTime);
+            }
+            
+            session.table->newSearch();
+            reply.search = session.search.run(board, positions, limits);
+            reply.move = reply.search.move;
+        }
+        
+        std::lock_guard<std::mutex> lock(session.mutex);
+        session.searching = false;
+        if (!session.game.play(reply.move)) {
+            throw std::runtime_error("the computer's move is illegal in the game");
+        }
+        reply.latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - requested);
+        return reply;
+    }
+
+private:
+    Options _options;
+    
+    mutable std::mutex _mutex;
+    std::unordered_map<SessionId, std::shared_ptr<Session>> _sessions;
+    SessionId _nextId{0};
+    
+    // Last, so it is destroyed first and its workers are done with the sessions before anything else goes
+    ThreadPool _pool;
+};
@@ -0,0 +1 @@
+#include "Tablebase.hpp"
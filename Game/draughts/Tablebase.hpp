@@ -0,0 +1,343 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "BitBoard.hpp"
+#include "MappedFile.hpp"
+
+/**
+ * Endgame tablebase: the exact outcome (win, draw or loss for the side to move) of every position with
+ * few pieces, stored per material in a file that is memory mapped for probing.
+ *
+ * Only positions with white to move are stored. A position with black to move is mirrored, which swaps
+ * the colors and turns the board around, and looked up in the table of the mirrored material. Positions
+ * are numbered by the placement of white men, white kings, black men and black kings in turn, every group
+ * ranked as a combination of the squares left free by the groups before it.
+ */
+class Tablebase
+{
+public:
+    enum class Value : uint8_t
+    {
+        Draw,
+        Win,
+        Loss,
+        
+        // A man on the row where it would have been promoted
+        Invalid
+    };
+    
+    struct Material
+    {
+        // White men, white kings, black men and black kings
+        std::array<uint8_t, 4> counts{};
+        
+        int pieces() const
+        {
+            return counts[0] + counts[1] + counts[2] + counts[3];
+        }
+        
+        int men() const
+        {
+            return counts[0] + counts[2];
+        }
+        
+        Material flipped() const
+        {
+            return Material{{counts[2], counts[3], counts[0], counts[1]}};
+        }
+        
+        uint32_t key() const
+        {
+            return counts[0] | counts[1] << 8 | counts[2] << 16 | static_cast<uint32_t>(counts[3]) << 24;
+        }
+        
+        std::string name() const
+        {
+            return "db-" + std::to_string(counts[0]) + "-" + std::to_string(counts[1]) + "-"
+                 + std::to_string(counts[2]) + "-" + std::to_string(counts[3]) + ".tb";
+        }
+        
+        bool operator ==(const Material& other) const
+        {
+            return counts == other.counts;
+        }
+    };
+    
+    static constexpr int kMaxPieces = 9;
+
+public:
+    Tablebase()
+    {
+    
+    }
+    
+    /**
+     * Maps every table in the directory.
+     */
+    Tablebase(const std::string& directory)
+    {
+        for (auto&& entry : std::filesystem::directory_iterator(directory)) {
+            if (entry.path().extension() == ".tb") {
+                load(entry.path().string());
+            }
+        }
+    }
+    
+    void load(const std::string& path)
+    {
+        MappedFile file(path);
+        if (file.size() < sizeof(Header)) {
+            throw std::runtime_error("invalid tablebase " + path);
+        }
+        
+        Header header;
+        std::memcpy(&header, file.data(), sizeof(Header));
+        if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.material.pieces() > kMaxPieces
+         || header.positions != size(header.material) || file.size() != sizeof(Header) + (header.positions + 3) / 4) {
+            throw std::runtime_error("invalid tablebase " + path);
+        }
+        
+        _tables.insert_or_assign(header.material.key(), std::move(file));
+        _pieces = std::max(_pieces, header.material.pieces());
+    }
+    
+    /**
+     * Most pieces of any loaded table, positions with more pieces are never found.
+     */
+    int pieces() const
+    {
+        return _pieces;
+    }
+    
+    bool contains(const Material& material) const
+    {
+        return _tables.count(material.key()) > 0;
+    }
+    
+    /**
+     * Looks up the outcome for the side to move, returns false if the material has no table.
+     */
+    bool probe(const BitBoard& board, Value& value) const
+    {
+        BitBoard oriented = board.turn == BitBoard::Color::White ? board : flip(board);
+        auto table = _tables.find(material(oriented).key());
+        if (table == _tables.end()) {
+            return false;
+        }
+        
+        uint64_t position = index(oriented);
+        const uint8_t* values = table->second.data() + sizeof(Header);
+        value = static_cast<Value>((values[position / 4] >> (position % 4 * 2)) & 3);
+        return true;
+    }
+    
+    /**
+     * Writes a table, `values` holding the outcome of every position of the material with white to move.
+     */
+    static void write(const std::string& path, const Material& material, const std::vector<Value>& values)
+    {
+        Header header;
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.material = material;
+        header.positions = values.size();
+        
+        std::vector<uint8_t> packed((values.size() + 3) / 4);
+        for (size_t i = 0; i < values.size(); ++i) {
+            packed[i / 4] |= static_cast<uint8_t>(values[i]) << (i % 4 * 2);
+        }
+        
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(packed.data()), packed.size());
+        if (!file) {
+            throw std::runtime_error("can't write tablebase " + path);
+        }
+    }
+    
+    static Material material(const BitBoard& board)
+    {
+        Material material;
+        material.counts[0] = static_cast<uint8_t>(BitBoard::popcount(board.white & ~board.kings));
+        material.counts[1] = static_cast<uint8_t>(BitBoard::popcount(board.white & board.kings));
+        material.counts[2] = static_cast<uint8_t>(BitBoard::popcount(board.black & ~board.kings));
+        material.counts[3] = static_cast<uint8_t>(BitBoard::popcount(board.black & board.kings));
+        return material;
+    }
+    
+    /**
+     * Amount of positions of the material, including the invalid ones.
+     */
+    static uint64_t size(const Material& material)
+    {
+        uint64_t size = 1;
+        int placed = 0;
+        for (int count : material.counts) {
+            size *= kBinomials[BitBoard::kSquares - placed][count];
+            placed += count;
+        }
+        
+        return size;
+    }
+    
+    /**
+     * Number of a position with white to move within the table of its material.
+     */
+    static uint64_t index(const BitBoard& board)
+    {
+        std::array<uint64_t, 4> groups = pieceGroups(board);
+        
+        uint64_t index = 0;
+        uint64_t placed = 0;
+        int placedCount = 0;
+        for (uint64_t group : groups) {
+            int count = BitBoard::popcount(group);
+            
+            // Colex rank of the group's squares, numbered among the squares not taken by earlier groups
+            uint64_t rank = 0;
+            int i = 0;
+            for (uint64_t pieces = group; pieces; pieces &= pieces - 1) {
+                int at = BitBoard::lowest(pieces);
+                int free = BitBoard::square(at) - BitBoard::popcount(placed & ((uint64_t{1} << at) - 1));
+                rank += kBinomials[free][++i];
+            }
+            
+            index = index * kBinomials[BitBoard::kSquares - placedCount][count] + rank;
+            placed |= group;
+            placedCount += count;
+        }
+        
+        return index;
+    }
+    
+    /**
+     * Sets up the position with the given number and white to move. Returns false for positions with a man
+     * on the row where it would have been promoted.
+     */
+    static bool position(const Material& material, uint64_t index, BitBoard& board)
+    {
+        std::array<uint64_t, 4> ranks;
+        int placedCount = material.pieces();
+        for (int group = 3; group >= 0; --group) {
+            placedCount -= material.counts[group];
+            uint64_t size = kBinomials[BitBoard::kSquares - placedCount][material.counts[group]];
+            ranks[group] = index % size;
+            index /= size;
+        }
+        
+        board = BitBoard();
+        uint64_t placed = 0;
+        for (int group = 0; group < 4; ++group) {
+            int count = material.counts[group];
+            std::array<int, kMaxPieces> frees;
+            uint64_t rank = ranks[group];
+            int largest = BitBoard::kSquares - 1 - BitBoard::popcount(placed);
+            for (int i = count; i > 0; --i) {
+                while (kBinomials[largest][i] > rank) {
+                    --largest;
+                }
+                frees[i - 1] = largest;
+                rank -= kBinomials[largest][i];
+                --largest;
+            }
+            
+            // Turn the numbers among the free squares back into squares
+            uint64_t groupMask = 0;
+            int free = 0;
+            int next = 0;
+            for (int square = 0; square < BitBoard::kSquares && next < count; ++square) {
+                if (placed & BitBoard::mask(square)) {
+                    continue;
+                }
+                if (free++ == frees[next]) {
+                    groupMask |= BitBoard::mask(square);
+                    ++next;
+                }
+            }
+            
+            placed |= groupMask;
+            bool white = group < 2;
+            bool king = group % 2 == 1;
+            (white ? board.white : board.black) |= groupMask;
+            if (king) {
+                board.kings |= groupMask;
+            }
+        }
+        
+        board.hash = board.computeHash();
+        
+        uint64_t whiteMen = board.white & ~board.kings;
+        uint64_t blackMen = board.black & ~board.kings;
+        return !(whiteMen & kWhitePromotion) && !(blackMen & kBlackPromotion);
+    }
+    
+    /**
+     * The same position seen from the other side: colors swapped and the board turned around.
+     */
+    static BitBoard flip(const BitBoard& board)
+    {
+        BitBoard flipped;
+        flipped.white = mirror(board.black);
+        flipped.black = mirror(board.white);
+        flipped.kings = mirror(board.kings);
+        flipped.turn = !board.turn;
+        flipped.hash = flipped.computeHash();
+        return flipped;
+    }
+
+private:
+    static constexpr char kMagic[4] = {'D', 'T', 'B', '1'};
+    
+    struct Header
+    {
+        char magic[4];
+        Material material;
+        uint64_t positions;
+    };
+    
+    static constexpr uint64_t kWhitePromotion = BitBoard::mask(0) | BitBoard::mask(1) | BitBoard::mask(2) | BitBoard::mask(3) | BitBoard::mask(4);
+    static constexpr uint64_t kBlackPromotion = BitBoard::mask(45) | BitBoard::mask(46) | BitBoard::mask(47) | BitBoard::mask(48) | BitBoard::mask(49);
+    
+    static constexpr auto kBinomials = [] {
+        std::array<std::array<uint64_t, kMaxPieces + 1>, BitBoard::kSquares + 1> binomials{};
+        for (int n = 0; n <= BitBoard::kSquares; ++n) {
+            binomials[n][0] = 1;
+            for (int k = 1; k <= kMaxPieces && k <= n; ++k) {
+                binomials[n][k] = binomials[n - 1][k - 1] + binomials[n - 1][k];
+            }
+        }
+        
+        return binomials;
+    }();
+    
+    static std::array<uint64_t, 4> pieceGroups(const BitBoard& board)
+    {
+        return {board.white & ~board.kings, board.white & board.kings, board.black & ~board.kings, board.black & board.kings};
+    }
+    
+    // Square s becomes square 49 - s, which in the bit layout is reversing the 54 used bits
+    static uint64_t mirror(uint64_t bits)
+    {
+        bits = ((bits >> 1) & 0x5555555555555555ULL) | ((bits & 0x5555555555555555ULL) << 1);
+        bits = ((bits >> 2) & 0x3333333333333333ULL) | ((bits & 0x3333333333333333ULL) << 2);
+        bits = ((bits >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((bits & 0x0F0F0F0F0F0F0F0FULL) << 4);
+        bits = ((bits >> 8) & 0x00FF00FF00FF00FFULL) | ((bits & 0x00FF00FF00FF00FFULL) << 8);
+        bits = ((bits >> 16) & 0x0000FFFF0000FFFFULL) | ((bits & 0x0000FFFF0000FFFFULL) << 16);
+        bits = (bits >> 32) | (bits << 32);
+        return bits >> (64 - BitBoard::kBits);
+    }
+
+private:
+    std::unordered_map<uint32_t, MappedFile> _tables;
+    int _pieces{0};
+};
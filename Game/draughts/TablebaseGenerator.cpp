@@ -0,0 +1 @@
+#include "TablebaseGenerator.hpp"
@@ -0,0 +1,339 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BitBoard.hpp"
+#include "Tablebase.hpp"
+
+/**
+ * Builds the tablebase by retrograde analysis, from the fewest pieces up.
+ *
+ * Every pass looks at the positions not decided yet: a position is won if a move leads to a lost position
+ * and lost if every move leads to a won position, so passes repeat until nothing changes and the positions
+ * left are draws. Captures and promotions lead to materials that were generated before, only quiet moves
+ * stay within the material being generated. A material and its mirror image reach each other by quiet
+ * moves, so they are generated together.
+ */
+class TablebaseGenerator
+{
+public:
+    struct Options
+    {
+        int pieces{4};
+        std::string directory{"tablebases"};
+        size_t threads{std::max(1u, std::thread::hardware_concurrency())};
+    };
+    
+    struct Progress
+    {
+        Tablebase::Material material;
+        uint64_t positions{0};
+        int passes{0};
+        
+        // Whether the table was loaded from an earlier run instead of generated
+        bool loaded{false};
+        
+        // Positions won, drawn and lost for white to move
+        uint64_t wins{0};
+        uint64_t draws{0};
+        uint64_t losses{0};
+    };
+
+public:
+    TablebaseGenerator(const Options& options)
+        : _options(options)
+    {
+        if (_options.pieces < 2 || _options.pieces > Tablebase::kMaxPieces) {
+            throw std::runtime_error("tablebase pieces must be between 2 and " + std::to_string(Tablebase::kMaxPieces));
+        }
+    }
+    
+    /**
+     * Generates every table up to the piece limit. Tables already in the directory are loaded instead, so an
+     * interrupted generation resumes with the first material that wasn't finished.
+     */
+    void run(std::function<void(const Progress&)> onTable = nullptr)
+    {
+        std::filesystem::create_directories(_options.directory);
+        
+        auto materials = this->materials();
+        for (size_t i = 0; i < materials.size(); ++i) {
+            if (_tablebase.contains(materials[i])) {
+                continue;
+            }
+            
+            Tablebase::Material flipped = materials[i].flipped();
+            std::vector<Slice> unit;
+            unit.emplace_back(materials[i]);
+            if (!(flipped == materials[i])) {
+                unit.emplace_back(flipped);
+            }
+            
+            if (resume(unit, onTable)) {
+                continue;
+            }
+            
+            int passes = generate(unit);
+            for (auto&& slice : unit) {
+                Progress progress = save(slice);
+                progress.passes = passes;
+                if (onTable) {
+                    onTable(progress);
+                }
+            }
+        }
+    }
+
+private:
+    static constexpr uint8_t kUnknown = 4;
+    static constexpr uint64_t kChunk = 4096;
+    
+    struct Slice
+    {
+        Slice(const Tablebase::Material& material)
+            : material(material)
+            , values(Tablebase::size(material))
+        {
+        
+        }
+        
+        Tablebase::Material material;
+        std::vector<std::atomic<uint8_t>> values;
+    };
+    
+    /**
+     * All materials with at least one piece per side, in the order they have to be generated in: by pieces
+     * and then by men, because a promotion turns a man into a king.
+     */
+    std::vector<Tablebase::Material> materials() const
+    {
+        std::vector<Tablebase::Material> materials;
+        int limit = _options.pieces;
+        for (int whiteMen = 0; whiteMen <= limit; ++whiteMen) {
+            for (int whiteKings = 0; whiteMen + whiteKings <= limit; ++whiteKings) {
+                for (int blackMen = 0; whiteMen + whiteKings + blackMen <= limit; ++blackMen) {
+                    for (int blackKings = 0; whiteMen + whiteKings + blackMen + blackKings <= limit; ++blackKings) {
+                        if (whiteMen + whiteKings > 0 && blackMen + blackKings > 0) {
+                            materials.push_back(Tablebase::Material{{static_cast<uint8_t>(whiteMen), static_cast<uint8_t>(whiteKings),
+                                                                     static_cast<uint8_t>(blackMen), static_cast<uint8_t>(blackKings)}});
+                        }
+                    }
+                }
+            }
+        }
+        
+        std::stable_sort(materials.begin(), materials.end(), [](const auto& a, const auto& b) {
+            return a.pieces() != b.pieces() ? a.pieces() < b.pieces() : a.men() < b.men();
+        });
+        return materials;
+    }
+    
+    bool resume(const std::vector<Slice>& unit, const std::function<void(const Progress&)>& onTable)
+    {
+        for (auto&& slice : unit) {
+            if (!std::filesystem::exists(path(slice.material))) {
+                return false;
+            }
+        }
+        
+        try {
+            for (auto&& slice : unit) {
+                _tablebase.load(path(slice.material));
+                
+                Progress progress;
+                progress.material = slice.material;
+                progress.positions = slice.values.size();
+                progress.loaded = true;
+                if (onTable) {
+                    onTable(progress);
+                }
+            }
+        } catch (const std::runtime_error&) {
+            // A table cut short by an interruption is generated again
+            return false;
+        }
+        
+        return true;
+    }
+    
+    /**
+     * Decides every position of the unit, returns the amount of passes it took.
+     */
+    int generate(std::vector<Slice>& unit)
+    {
+        for (auto&& slice : unit) {
+            for (auto&& value : slice.values) {
+                value.store(kUnknown, std::memory_order_relaxed);
+            }
+        }
+        
+        int passes = 0;
+        for (bool changed = true; changed; ++passes) {
+            changed = pass(unit);
+        }
+        
+        for (auto&& slice : unit) {
+            for (auto&& value : slice.values) {
+                if (value.load(std::memory_order_relaxed) == kUnknown) {
+                    value.store(static_cast<uint8_t>(Tablebase::Value::Draw), std::memory_order_relaxed);
+                }
+            }
+        }
+        
+        return passes;
+    }
+    
+    /**
+     * One pass over the undecided positions, split in chunks over the threads. A position decided in this
+     * pass may already be seen by positions later in the same pass, which only makes it converge faster.
+     */
+    bool pass(std::vector<Slice>& unit)
+    {
+        std::atomic<bool> changed{false};
+        std::vector<std::atomic<uint64_t>> next(unit.size());
+        std::atomic<bool> failed{false};
+        std::exception_ptr error;
+        
+        std::vector<std::thread> workers;
+        for (size_t thread = 0; thread < _options.threads; ++thread) {
+            workers.emplace_back([&]() {
+                try {
+                    work(unit, next, changed, failed);
+                } catch (...) {
+                    // Only the first error is kept, the other workers stop at their next chunk
+                    if (!failed.exchange(true)) {
+                        error = std::current_exception();
+                    }
+                }
+            });
+        }
+        
+        for (auto&& worker : workers) {
+            worker.join();
+        }
+        
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        
+        return changed;
+    }
+    
+    /**
+     * Loop of a worker thread, deciding chunks of undecided positions until none are left.
+     */
+    void work(std::vector<Slice>& unit, std::vector<std::atomic<uint64_t>>& next, std::atomic<bool>& changed, const std::atomic<bool>& failed) const
+    {
+        BitBoard::MoveList moves;
+        for (size_t s = 0; s < unit.size(); ++s) {
+            auto& values = unit[s].values;
+            for (uint64_t start = next[s]++ * kChunk; start < values.size() && !failed; start = next[s]++ * kChunk) {
+                for (uint64_t index = start; index < std::min<uint64_t>(start + kChunk, values.size()); ++index) {
+                    if (values[index].load(std::memory_order_relaxed) != kUnknown) {
+                        continue;
+                    }
+                    
+                    uint8_t value = resolve(unit, unit[s].material, index, moves);
+                    if (value != kUnknown) {
+                        values[index].store(value, std::memory_order_relaxed);
+                        changed = true;
+                    }
+                }
+            }
+        }
+    }
+    
+    uint8_t resolve(const std::vector<Slice>& unit, const Tablebase::Material& material, uint64_t index, BitBoard::MoveList& moves) const
+    {
+        BitBoard board;
+        if (!Tablebase::position(material, index, board)) {
+            return static_cast<uint8_t>(Tablebase::Value::Invalid);
+        }
+        
+        board.generate(moves);
+        if (moves.empty()) {
+            return static_cast<uint8_t>(Tablebase::Value::Loss);
+        }
+        
+        bool allWins = true;
+        for (auto&& move : moves) {
+            uint8_t value = valueOf(unit, Tablebase::flip(board.apply(move)));
+            if (value == static_cast<uint8_t>(Tablebase::Value::Loss)) {
+                return static_cast<uint8_t>(Tablebase::Value::Win);
+            }
+            allWins &= value == static_cast<uint8_t>(Tablebase::Value::Win);
+        }
+        
+        return allWins ? static_cast<uint8_t>(Tablebase::Value::Loss) : kUnknown;
+    }
+    
+    /**
+     * Outcome of a position with white to move, possibly not decided yet when it has the material of the unit.
+     */
+    uint8_t valueOf(const std::vector<Slice>& unit, const BitBoard& board) const
+    {
+        // The side to move lost its last piece
+        if (board.white == 0) {
+            return static_cast<uint8_t>(Tablebase::Value::Loss);
+        }
+        
+        Tablebase::Material material = Tablebase::material(board);
+        for (auto&& slice : unit) {
+            if (slice.material == material) {
+                return slice.values[Tablebase::index(board)].load(std::memory_order_relaxed);
+            }
+        }
+        
+        // Captures and promotions always lead to materials generated before, unless their table went missing
+        Tablebase::Value value;
+        if (!_tablebase.probe(board, value)) {
+            throw std::runtime_error("tablebase " + material.name() + " is missing, it has to be generated first");
+        }
+        return static_cast<uint8_t>(value);
+    }
+    
+    /**
+     * Writes the table next to its final name first, so an interruption never leaves a partial table behind.
+     */
+    Progress save(const Slice& slice)
+    {
+        Progress progress;
+        progress.material = slice.material;
+        progress.positions = slice.values.size();
+        
+        std::vector<Tablebase::Value> values(slice.values.size());
+        for (size_t i = 0; i < values.size(); ++i) {
+            values[i] = static_cast<Tablebase::Value>(slice.values[i].load(std::memory_order_relaxed));
+            progress.wins += values[i] == Tablebase::Value::Win;
+            progress.draws += values[i] == Tablebase::Value::Draw;
+            progress.losses += values[i] == Tablebase::Value::Loss;
+        }
+        
+        std::string path = this->path(slice.material);
+        Tablebase::write(path + ".part", slice.material, values);
+        std::filesystem::rename(path + ".part", path);
+        _tablebase.load(path);
+        return progress;
+    }
+    
+    std::string path(const Tablebase::Material& material) const
+    {
+        return (std::filesystem::path(_options.directory) / material.name()).string();
+    }
+
+private:
+    Options _options;
+    
+    // The tables generated so far, probed for positions after captures and promotions
+    Tablebase _tablebase;
+};
@@ -0,0 +1 @@
+#include "ThreadPool.hpp"
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed set of worker threads running tasks. Every worker has its own queue, so submitting and taking
+ * tasks rarely contend on a lock, and a worker whose queue runs dry steals from the others. Tasks
+ * submitted from a worker go to its own queue, tasks from other threads are spread over all queues.
+ *
+ * Tasks are taken oldest first, from the own queue as well as when stealing. Tasks here are independent
+ * searches, so running them in the order they came in matters more than the cache locality of running
+ * the newest first.
+ */
+class ThreadPool
+{
+public:
+    using Task = std::function<void()>;
+
+public:
+    ThreadPool(size_t threads = std::thread::hardware_concurrency())
+    {
+        threads = std::max<size_t>(threads, 1);
+        for (size_t i = 0; i < threads; ++i) {
+            _queues.emplace_back(std::make_unique<Queue>());
+        }
+        for (size_t i = 0; i < threads; ++i) {
+            _workers.emplace_back([this, i]() {
+                work(i);
+            });
+        }
+    }
+    
+    /**
+     * Runs the tasks still queued, then stops the workers.
+     */
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _quit = true;
+        }
+        _condition.notify_all();
+        for (auto&& worker : _workers) {
+            worker.join();
+        }
+    }
+    
+    void submit(Task task)
+    {
+        // Counted under the lock the workers sleep on, so a worker can't miss the task on its way to sleep,
+        // and before it is queued, so the count never drops below zero
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            ++_pending;
+        }
+        
+        size_t index = _current == this ? _currentIndex : _next++ % _queues.size();
+        {
+            std::lock_guard<std::mutex> lock(_queues[index]->mutex);
+            _queues[index]->tasks.push_back(std::move(task));
+        }
+        _condition.notify_one();
+    }
+    
+    size_t threads() const
+    {
+        return _workers.size();
+    }
+    
+    /**
+     * Tasks taken from the queue of another worker so far.
+     */
+    uint64_t steals() const
+    {
+        return _steals;
+    }
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+private:
+    void work(size_t index)
+    {
+        _current = this;
+        _currentIndex = index;
+        
+        while (true) {
+            Task task;
+            if (take(index, task)) {
+                task();
+                continue;
+            }
+            
+            std::unique_lock<std::mutex> lock(_mutex);
+            _condition.wait(lock, [this]() {
+                return _quit || _pending > 0;
+            });
+            if (_quit && _pending == 0) {
+                return;
+            }
+        }
+    }
+    
+    /**
+     * Takes the oldest task of the worker's own queue, or else of the first other queue that has one.
+     */
+    bool take(size_t index, Task& task)
+    {
+        for (size_t i = 0; i < _queues.size(); ++i) {
+            Queue& queue = *_queues[(index + i) % _queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty()) {
+                continue;
+            }
+            
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            _steals += i > 0;
+            
+            std::lock_guard<std::mutex> pendingLock(_mutex);
+            --_pending;
+            return true;
+        }
+        
+        return false;
+    }
+
+private:
+    std::vector<std::unique_ptr<Queue>> _queues;
+    std::vector<std::thread> _workers;
+    std::atomic<size_t> _next{0};
+    std::atomic<uint64_t> _steals{0};
+    
+    // Tasks in all queues together, guarded by the mutex
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    size_t _pending{0};
+    bool _quit{false};
+    
+    // The pool and queue of the worker running on this thread, if any
+    inline static thread_local ThreadPool* _current{nullptr};
+    inline static thread_local size_t _currentIndex{0};
+};
@@ -0,0 +1 @@
+#include "TrainingData.hpp"
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "BitBoard.hpp"
+
+/**
+ * Positions labelled with a search score and the outcome of the game they were played in, for training
+ * evaluations outside of the engine.
+ *
+ * A training file is a header followed by fixed size records until the end of the file, so files from
+ * several runs can be appended to each other after dropping the header. Records are stored in the byte
+ * order of the machine that wrote them.
+ */
+class TrainingData
+{
+public:
+    struct Record
+    {
+        uint64_t white;
+        uint64_t black;
+        uint64_t kings;
+        
+        // Alpha-beta search score in centipieces and outcome, 1 for a win, 0 for a draw and -1 for a loss,
+        // both for the side to move
+        int16_t score;
+        int8_t result;
+        uint8_t turn;
+        uint32_t reserved;
+    };
+
+public:
+    static Record record(const BitBoard& board, int32_t score, int result)
+    {
+        Record record{};
+        record.white = board.white;
+        record.black = board.black;
+        record.kings = board.kings;
+        record.score = static_cast<int16_t>(std::clamp<int32_t>(score, INT16_MIN, INT16_MAX));
+        record.result = static_cast<int8_t>(result);
+        record.turn = static_cast<uint8_t>(board.turn);
+        return record;
+    }
+    
+    static BitBoard board(const Record& record)
+    {
+        BitBoard board;
+        board.white = record.white;
+        board.black = record.black;
+        board.kings = record.kings;
+        board.turn = static_cast<BitBoard::Color>(record.turn);
+        board.hash = board.computeHash();
+        return board;
+    }
+    
+    /**
+     * Adds records to the end of a training file, creating it when it doesn't exist yet.
+     */
+    static void append(const std::string& path, const std::vector<Record>& records)
+    {
+        bool exists = std::ifstream(path).good();
+        std::ofstream file(path, std::ios::binary | std::ios::app);
+        if (!exists) {
+            file.write(kMagic, sizeof(kMagic));
+        }
+        file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(Record));
+        if (!file) {
+            throw std::runtime_error("can't write training data " + path);
+        }
+    }
+    
+    static std::vector<Record> read(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        auto size = static_cast<size_t>(file.tellg());
+        file.seekg(0);
+        
+        char magic[sizeof(kMagic)];
+        if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 || (size - sizeof(kMagic)) % sizeof(Record) != 0) {
+            throw std::runtime_error("invalid training data " + path);
+        }
+        
+        std::vector<Record> records((size - sizeof(kMagic)) / sizeof(Record));
+        if (!file.read(reinterpret_cast<char*>(records.data()), records.size() * sizeof(Record))) {
+            throw std::runtime_error("invalid training data " + path);
+        }
+        
+        return records;
+    }
+
+private:
+    static constexpr char kMagic[8] = {'D', 'T', 'D', '1', 0, 0, 0, 0};
+};
@@ -0,0 +1 @@
+#include "TranspositionTable.hpp"
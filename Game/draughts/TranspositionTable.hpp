@@ -0,0 +1,183 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "BitBoard.hpp"
+
+/**
+ * Fixed size hash table of search results, shared by all search threads without locks.
+ *
+ * Every entry is stored as two 64-bit words, the packed data and the hash xor'ed with that data. A reader
+ * only accepts an entry when both words still match the hash, so an entry torn by two threads writing at
+ * the same time reads as a miss instead of as a corrupt result. Entries are grouped in cache line sized
+ * buckets and replaced by depth and age, so the table can persist between the turns of a game.
+ */
+class TranspositionTable
+{
+public:
+    static constexpr uint8_t kNoMove = 0xFF;
+    
+    static_assert(BitBoard::MoveList::kCapacity <= kNoMove, "the index of every move has to differ from no move");
+    
+    enum class Bound : uint8_t
+    {
+        None,
+        Exact,
+        Lower,
+        Upper
+    };
+    
+    struct Entry
+    {
+        int32_t score{0};
+        int8_t depth{0};
+        Bound bound{Bound::None};
+        
+        // Index of the best move in the position's generated move list
+        uint8_t move{kNoMove};
+    };
+
+public:
+    TranspositionTable(size_t megabytes)
+    {
+        resize(megabytes);
+    }
+    
+    void resize(size_t megabytes)
+    {
+        // Round down to a power of two so the bucket index is a simple mask
+        size_t buckets = 1;
+        while (buckets * 2 * sizeof(Bucket) <= megabytes * 1024 * 1024) {
+            buckets *= 2;
+        }
+        
+        _buckets = std::vector<Bucket>(buckets);
+        _mask = buckets - 1;
+        _generation = 0;
+    }
+    
+    void clear()
+    {
+        for (auto&& bucket : _buckets) {
+            for (auto&& slot : bucket.slots) {
+                slot.key.store(0, std::memory_order_relaxed);
+                slot.data.store(0, std::memory_order_relaxed);
+            }
+        }
+        
+        _generation = 0;
+    }
+    
+    /**
+     * Marks the start of a new search, so entries of earlier searches are replaced first.
+     */
+    void newSearch()
+    {
+        _generation = (_generation + 1) & kGenerationMask;
+    }
+    
+    bool probe(uint64_t hash, Entry& entry) const
+    {
+        for (auto&& slot : _buckets[hash & _mask].slots) {
+            uint64_t data = slot.data.load(std::memory_order_relaxed);
+            if ((slot.key.load(std::memory_order_relaxed) ^ data) == hash && data != 0) {
+                entry = unpack(data);
+                return true;
+            }
+        }
+        
+        return false;
+    }
+    
+    void store(uint64_t hash, int depth, int32_t score, Bound bound, uint8_t move)
+    {
+        auto& slots = _buckets[hash & _mask].slots;
+        
+        // Prefer the slot of the same position, otherwise the shallowest and oldest one
+        Slot* replace = &slots[0];
+        int replaceWorth = INT32_MAX;
+        for (auto&& slot : slots) {
+            uint64_t data = slot.data.load(std::memory_order_relaxed);
+            if ((slot.key.load(std::memory_order_relaxed) ^ data) == hash) {
+                Entry entry = unpack(data);
+                
+                // Keep a deeper result of the same position unless the new one is exact
+                if (bound != Bound::Exact && entry.depth > depth && generation(data) == _generation) {
+                    return;
+                }
+                
+                if (move == kNoMove) {
+                    move = entry.move;
+                }
+                
+                replace = &slot;
+                break;
+            }
+            
+            int age = (_generation - generation(data)) & kGenerationMask;
+            int worth = unpack(data).depth - 8 * age;
+            if (worth < replaceWorth) {
+                replaceWorth = worth;
+                replace = &slot;
+            }
+        }
+        
+        uint64_t data = pack(depth, score, bound, move);
+        replace->key.store(hash ^ data, std::memory_order_relaxed);
+        replace->data.store(data, std::memory_order_relaxed);
+    }
+    
+    size_t size() const
+    {
+        return _buckets.size() * kSlots;
+    }
+
+private:
+    static constexpr int kSlots = 4;
+    static constexpr uint32_t kGenerationMask = 0x3F;
+    
+    struct Slot
+    {
+        std::atomic<uint64_t> key{0};
+        std::atomic<uint64_t> data{0};
+    };
+    
+    struct alignas(64) Bucket
+    {
+        std::array<Slot, kSlots> slots;
+    };
+    
+    // Layout of the data word: score in the upper 32 bits, then depth, bound, generation and move
+    uint64_t pack(int depth, int32_t score, Bound bound, uint8_t move) const
+    {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(score)) << 32)
+             | (static_cast<uint64_t>(static_cast<uint8_t>(depth)) << 24)
+             | (static_cast<uint64_t>(bound) << 22)
+             | (static_cast<uint64_t>(_generation) << 16)
+             | move;
+    }
+    
+    static Entry unpack(uint64_t data)
+    {
+        Entry entry;
+        entry.score = static_cast<int32_t>(static_cast<uint32_t>(data >> 32));
+        entry.depth = static_cast<int8_t>((data >> 24) & 0xFF);
+        entry.bound = static_cast<Bound>((data >> 22) & 0x3);
+        entry.move = static_cast<uint8_t>(data & 0xFF);
+        return entry;
+    }
+    
+    static uint32_t generation(uint64_t data)
+    {
+        return (data >> 16) & kGenerationMask;
+    }
+
+private:
+    std::vector<Bucket> _buckets;
+    size_t _mask{0};
+    uint32_t _generation{0};
+};
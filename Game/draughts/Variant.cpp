@@ -0,0 +1 @@
+#include "Variant.hpp"
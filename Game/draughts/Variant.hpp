@@ -0,0 +1,52 @@
+#pragma once
+
+/**
+ * Rules that differ between draughts variants. They are compile time constants, so the move generator is
+ * specialized for every variant instead of checking the rules while generating.
+ */
+struct International
+{
+    static constexpr int kSize = 10;
+    static constexpr int kStartRows = 4;
+    
+    // Kings move and capture over any distance instead of a single square
+    static constexpr bool kFlyingKings = true;
+    
+    static constexpr bool kMenCaptureBackward = true;
+    
+    // Only the captures taking the most pieces are legal, instead of any capture
+    static constexpr bool kMaximumCapture = true;
+    
+    // A man passing the opposite back row while capturing is promoted and continues capturing as a king,
+    // instead of only being promoted when its move ends there
+    static constexpr bool kPromoteDuringCapture = false;
+    
+    // Moves of each side with only kings moving and nothing captured after which the game is drawn
+    static constexpr int kDrawMoves = 25;
+};
+
+struct Russian
+{
+    static constexpr int kSize = 8;
+    static constexpr int kStartRows = 3;
+    static constexpr bool kFlyingKings = true;
+    static constexpr bool kMenCaptureBackward = true;
+    static constexpr bool kMaximumCapture = false;
+    static constexpr bool kPromoteDuringCapture = true;
+    static constexpr int kDrawMoves = 15;
+};
+
+/**
+ * English draughts, or checkers. Black moves first in it, which only changes which color the position
+ * calls white.
+ */
+struct English
+{
+    static constexpr int kSize = 8;
+    static constexpr int kStartRows = 3;
+    static constexpr bool kFlyingKings = false;
+    static constexpr bool kMenCaptureBackward = false;
+    static constexpr bool kMaximumCapture = false;
+    static constexpr bool kPromoteDuringCapture = false;
+    static constexpr int kDrawMoves = 40;
+};
@@ -0,0 +1 @@
+#include "Zobrist.hpp"
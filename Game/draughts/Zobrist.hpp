@@ -0,0 +1,49 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+/**
+ * Random keys for hashing positions. A position's hash is the xor of the keys of all its pieces, plus the
+ * side key when black is to move, so a move only has to xor the keys of the squares it changes.
+ */
+class Zobrist
+{
+public:
+    enum class Piece : uint8_t
+    {
+        WhiteMan,
+        BlackMan,
+        WhiteKing,
+        BlackKing
+    };
+
+public:
+    static uint64_t piece(Piece piece, int bit)
+    {
+        return kKeys[static_cast<int>(piece) * 64 + bit];
+    }
+    
+    static uint64_t side()
+    {
+        return kKeys[kPieceKeys];
+    }
+
+private:
+    static constexpr int kPieceKeys = 4 * 64;
+    
+    // Generated at compile time with splitmix64 so hashes are identical across runs and machines
+    static constexpr std::array<uint64_t, kPieceKeys + 1> kKeys = [] {
+        std::array<uint64_t, kPieceKeys + 1> keys{};
+        uint64_t state = 0x9E3779B97F4A7C15ULL;
+        for (auto&& key : keys) {
+            state += 0x9E3779B97F4A7C15ULL;
+            uint64_t z = state;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            key = z ^ (z >> 31);
+        }
+        
+        return keys;
+    }();
+};
@@ -3,19 +3,22 @@
 #include "Object.hpp"
 
 #include <array>
+#include <filesystem>
 #include <future>
 #include <iostream>
 #include <map>
 #include <memory>
 #include <optional>
-#include <random>
 #include <string>
 #include <thread>
 
+#include "Ai.hpp"
+#include "BitBoard.hpp"
 #include "Board.hpp"
 #include "CommandPool.hpp"
 #include "Device.hpp"
 #include "Draught.hpp"
+#include "GameState.hpp"
 #include "Object.hpp"
 
 inline Draught::Color operator !(Draught::Color color)
@@ -23,147 +26,41 @@ inline Draught::Color operator !(Draught::Color color)
     return color == Draught::Color::White ? Draught::Color::Black : Draught::Color::White;
 }
 
-using BoardMatrix = std::array<std::array<Draught*, 10>, 10>;
+using DraughtsBySquare = std::array<Draught*, BitBoard::kSquares>;
 
+/**
+ * Renders a game of draughts and handles the player's input. The rules are played by GameState and the
+ * computer's moves by Ai, this class only mirrors their moves on the draughts on the board.
+ */
 class Draughts
 {
+    // Time the computer may spend thinking about a move
+    static constexpr std::chrono::milliseconds kAiTimeBudget{50};
+    
+    // Megabytes of memory for the computer to remember positions it searched before
+    static constexpr size_t kAiHashSize = 64;
+    
+    // Opening moves the computer plays without thinking, if the book exists
+    static constexpr const char* kOpeningBook = "books/opening.book";
+    
+    // Tuned evaluation weights, written by the tune tool, if they exist
+    static constexpr const char* kWeights = "weights/draughts.weights";
+    
+    // Neural network the computer evaluates positions with, if it exists
+    static constexpr const char* kNetwork = "networks/draughts.nnue";
+    
     struct Move
     {
         Draught* draught;
         std::vector<Draught::Position> moves;
         std::vector<Draught*> captured;
-        int32_t maxNetCaptureWin;
+        BitBoard::Move bitBoardMove;
     };
 
-    class Ai
-    {
-    public:
-        Ai(Draught::Color color)
-            : _color(color)
-        {
-            // Initialize random number generator
-            _rng = std::mt19937(_dev());
-            _dist = std::uniform_int_distribution<std::mt19937::result_type>(0, 1000);
-        }
-        
-        std::shared_ptr<std::future<Move>> future()
-        {
-            return _future;
-        }
-        
-        void reset()
-        {
-            _future = nullptr;
-        }
-        
-        void findOptimalMoveAsync(BoardMatrix boardMatrix, std::vector<Move> allPossibleMoves)
-        {
-            _future = std::make_shared<std::future<Move>>(std::async(std::launch::async, &Ai::findOptimalMove, this, boardMatrix, allPossibleMoves));
-        }
-        
-    private:
-        Move findOptimalMove(BoardMatrix boardMatrix, std::vector<Move> allPossibleMoves)
-        {
-            _pathsWandered = 0;
-            int32_t maxNetCaptureWin = 0;
-            for (auto&& possibleMove : allPossibleMoves) {
-                possibleMove.maxNetCaptureWin = checkNetCaptureWin(possibleMove, boardMatrix, !_color, 3);
-                maxNetCaptureWin = std::max(maxNetCaptureWin, possibleMove.maxNetCaptureWin);
-            }
-            
-            // Remove the less optimal moves
-            //allPossibleMoves.erase(std::remove_if(allPossibleMoves.begin(), allPossibleMoves.end(), [&maxNetCaptureWin](auto& possibleMove) {
-            //    return possibleMove.maxNetCaptureWin < maxNetCaptureWin;
-            //}), allPossibleMoves.end());
-
-            // Select random move from the remaining equal possibilities
-            uint32_t selectedMove = _dist(_rng) % allPossibleMoves.size();
 
-            std::cout << "Amount of paths wandered: " << _pathsWandered << std::endl;
-            return allPossibleMoves.at(selectedMove);
-        }
-        
-        /**
-         * Calculates recursively the amount of relative captures a move would make in it's depth.
-         * A positive number means a relative capture win for white, a negative for black.
-         */
-        int32_t checkNetCaptureWin(Move move, BoardMatrix boardMatrix, Draught::Color turn, uint8_t depth)
-        {
-            _pathsWandered++;
-            auto oldPosition = move.draught->position();
-            boardMatrix[oldPosition.y][oldPosition.x] = nullptr;
-            auto newPosition = move.moves[move.moves.size()-1];
-            boardMatrix[newPosition.y][newPosition.x] = move.draught;
-            
-            for (auto& captured : move.captured) {
-                auto capturedPosition = captured->position();
-                boardMatrix[capturedPosition.y][capturedPosition.x] = nullptr;
-            }
-            
-            std::vector<Move> allPossibleMoves;
-            for (int index = 0; index < 100; index++) {
-                auto draught = boardMatrix[index/10][index%10];
-                if (draught == nullptr || draught->color() != turn) {
-                    continue;
-                }
-                
-                auto possibleMoves = findMoves(boardMatrix, draught, draught->position(), {});
-                allPossibleMoves.insert(allPossibleMoves.end(), possibleMoves.begin(), possibleMoves.end());
-            }
-            
-            if (allPossibleMoves.empty()) {
-                return 0;
-            }
-            
-            auto maxCapture = std::max_element(allPossibleMoves.begin(), allPossibleMoves.end(), [](auto& a, auto& b) {
-                return a.captured.size() < b.captured.size();
-            })->captured.size();
-            
-            allPossibleMoves.erase(std::remove_if(allPossibleMoves.begin(), allPossibleMoves.end(), [&maxCapture](auto& possibleMove) {
-                return possibleMove.captured.size() < maxCapture;
-            }), allPossibleMoves.end());
-            
-            int32_t maxNetCaptureWin = 0;
-            for (auto&& possibleMove : allPossibleMoves) {
-                int32_t netCaptureWin = static_cast<int32_t>(possibleMove.captured.size());
-                if (_color != turn) {
-                    netCaptureWin *= -1;
-                }
-                
-                if (depth > 0) {
-                    netCaptureWin += checkNetCaptureWin(possibleMove,
-                                                        boardMatrix,
-                                                        !turn,
-                                                        depth - 1);
-                }
-                
-                if (_color == turn) {
-                    maxNetCaptureWin = std::max(maxNetCaptureWin, netCaptureWin);
-                } else {
-                    maxNetCaptureWin = std::min(maxNetCaptureWin, netCaptureWin);
-                }
-            }
-            
-            return maxNetCaptureWin;
-        }
-        
-    private:
-        const Draught::Color _color;
-
-        bool _calculating{false};
-        std::shared_ptr<std::future<Move>> _future;
-        
-        // Debugging of amount of nodes in AI branches
-        int32_t _pathsWandered;
-        
-        std::random_device _dev;
-        std::mt19937 _rng;
-        std::uniform_int_distribution<std::mt19937::result_type> _dist;
-    };
-    
 public:
     Draughts(std::shared_ptr<Device> device, std::shared_ptr<CommandPool> commandPool)
-        : _ai(Draught::Color::Black)
+        : _ai(kAiTimeBudget, kAiHashSize)
     {
         
         _boardObject = std::make_shared<Object>(device, commandPool, "objects/draughts_board.obj", 3, 1);
@@ -180,6 +77,21 @@ public:
                                           : Draught::Color::Black;
             _draughts.emplace_back(_draughtsObject->instanceData(i), Draught::Position{x, y}, color);
         }
+        
+        if (std::filesystem::exists(kOpeningBook)) {
+            _ai.loadBook(kOpeningBook);
+        }
+        if (std::filesystem::exists(kWeights)) {
+            _ai.loadWeights(kWeights);
+        }
+        if (std::filesystem::exists(kNetwork)) {
+            _ai.loadNetwork(kNetwork);
+        }
+        
+        _draughtsBySquare.fill(nullptr);
+        for (auto&& draught : _draughts) {
+            _draughtsBySquare[toSquare(draught.position())] = &draught;
+        }
     }
     
     std::shared_ptr<Object> boardObject()
@@ -194,42 +106,19 @@ public:
     
     void move(std::optional<Draught::Position> playerMove = std::nullopt)
     {
-        BoardMatrix boardMatrix;
-        for (int i = 0; i < 100; ++i) {
-            boardMatrix[i/10][i%10] = nullptr;
-        }
-        
-        std::for_each(_draughts.begin(), _draughts.end(), [this, &boardMatrix](Draught& draught) {
-            if (draught.state() != Draught::State::Captured && draught.state() != Draught::State::Crown) {
-                auto position = draught.position();
-                boardMatrix[position.y][position.x] = &draught;
-            }
-        });
-        
-        std::vector<Move> allPossibleMoves;
-        for (int index = 0; index < 100; index++) {
-            auto draught = boardMatrix[index/10][index%10];
-            if (draught == nullptr || draught->color() != _turn) {
-                continue;
-            }
-            
-            auto possibleMoves = findMoves(boardMatrix, draught, draught->position(), {});
-            allPossibleMoves.insert(allPossibleMoves.end(), possibleMoves.begin(), possibleMoves.end());
+        if (_game.result() == GameState::Result::Draw) {
+            std::cout << "The game is a draw!..." << std::endl;
+            return;
         }
-        
-        // Nothing possible anymore! TODO: Handle win.
-        if (allPossibleMoves.empty()) {
-            std::cout << (_turn == Draught::Color::White ? "White" : "Black") << " is the winner!..." << std::endl;
+        if (_game.result() != GameState::Result::Ongoing) {
+            std::cout << (_game.result() == GameState::Result::WhiteWins ? "White" : "Black") << " is the winner!..." << std::endl;
             return;
         }
         
-        auto maxCapture = std::max_element(allPossibleMoves.begin(), allPossibleMoves.end(), [](auto& a, auto& b) {
-            return a.captured.size() < b.captured.size();
-        })->captured.size();
-        
-        allPossibleMoves.erase(std::remove_if(allPossibleMoves.begin(), allPossibleMoves.end(), [&maxCapture](auto& possibleMove) {
-            return possibleMove.captured.size() < maxCapture;
-        }), allPossibleMoves.end());
+        std::vector<Move> allPossibleMoves;
+        for (auto&& possibleMove : _game.legalMoves()) {
+            allPossibleMoves.emplace_back(toMove(possibleMove));
+        }
         
         Move move;
         if (playerMove) {
@@ -261,6 +150,7 @@ public:
                 if (_playerMoves.size() == possibleMove.moves.size()) {
                     move.moves = _playerMoves;
                     move.captured = possibleMove.captured;
+                    move.bitBoardMove = possibleMove.bitBoardMove;
                     break;
                 } else {
                     // Move not finished yet
@@ -283,7 +173,7 @@ public:
             _playerMoves.clear();
         } else if (_ai.future() && _ai.future()->valid()) {
             if (_ai.future()->wait_for(std::chrono::milliseconds(0)) == std::future_status::ready) {
-                move = _ai.future()->get();
+                move = toMove(_ai.future()->get().best.move);
                 _ai.reset();
             } else {
                 // Continue idling if AI is not done yet
@@ -291,19 +181,35 @@ public:
             }
         } else {
             // Start async check for most optimal move
-            _ai.findOptimalMoveAsync(boardMatrix, allPossibleMoves);
+            _ai.findOptimalMoveAsync(_game.board(), _game.positions());
             return;
         }
-
+        
+        Draught::Color turn = _game.turn() == BitBoard::Color::White ? Draught::Color::White : Draught::Color::Black;
+        if (!_game.play(move.bitBoardMove)) {
+            std::cerr << "Move not allowed by the rules." << std::endl;
+            return;
+        }
+        
+        // Think about the next move while the player chooses theirs
+        if (turn == Draught::Color::Black && _game.result() == GameState::Result::Ongoing) {
+            _ai.ponder(_game.board(), _game.positions());
+        }
+        
+        _draughtsBySquare[move.bitBoardMove.from] = nullptr;
+        _draughtsBySquare[move.bitBoardMove.to] = move.draught;
+        for (auto&& captured : move.captured) {
+            _draughtsBySquare[toSquare(captured->position())] = nullptr;
+        }
+        
         move.draught->setPosition(move.moves);
         if (move.draught->state() != Draught::State::Lady) {
-            if ((_turn == Draught::Color::White && move.draught->position().x == 9)
-             || (_turn == Draught::Color::Black && move.draught->position().x == 0)) {
+            if (_game.promoted()) {
                 move.draught->setState(Draught::State::Lady);
                 
                 // Make the last captured piece the crown
                 for (auto&& draught : _draughts) {
-                    if (_turn == Draught::Color::White) {
+                    if (turn == Draught::Color::White) {
                         if (draught.id() == _capturedWhiteIds[_capturedWhiteIds.size()-1]) {
                             move.draught->setCrown(&draught);
                             _capturedWhiteIds.erase(std::prev(_capturedWhiteIds.end()));
@@ -335,7 +241,7 @@ public:
             
             int8_t x;
             int8_t y;
-            if (_turn == Draught::Color::White) {
+            if (turn == Draught::Color::White) {
                 x = _capturedBlackIds.size() % 5;
                 y = -1 - _capturedBlackIds.size() / 5;
                 _capturedBlackIds.emplace_back(move.captured[i]->id());
@@ -349,8 +255,14 @@ public:
             move.captured[i]->setPosition(moves);
             move.captured[i]->setState(Draught::State::Captured);
         }
-        
-        _turn = !_turn;
+    }
+    
+    /**
+     * Makes the computer play the best move it found so far instead of thinking on.
+     */
+    void moveNow()
+    {
+        _ai.moveNow();
     }
     
     void update()
@@ -360,7 +272,7 @@ public:
             animating |= draught.animate();
         });
         
-        if (!animating && _turn == Draught::Color::Black) {
+        if (!animating && _game.turn() == BitBoard::Color::Black) {
             // Reset selection once computer start moving
             _board->resetSelected();
             std::for_each(_draughts.begin(), _draughts.end(), [](auto& draught) {
@@ -375,125 +287,60 @@ public:
     {
         return _draughts;
     }
-    
+
 private:
-    static std::vector<Move> findMoves(BoardMatrix boardMatrix, Draught* draught, Draught::Position position, std::vector<int8_t> capturedIds)
+    static int toSquare(Draught::Position position)
+    {
+        // The human plays white from the x == 0 side, which is the bottom of the official numbering
+        int row = 9 - position.x;
+        int column = 9 - position.y;
+        return row * BitBoard::kRowSquares + column / 2;
+    }
+    
+    static Draught::Position toPosition(int square)
     {
-        std::vector<Move> possibleMoves;
-        bool lady = draught->state() == Draught::State::Lady;
-        Draught::Color turn = draught->color();
+        int row = square / BitBoard::kRowSquares;
+        int column = (square % BitBoard::kRowSquares) * 2 + (row % 2 == 0 ? 1 : 0);
+        return Draught::Position{static_cast<int8_t>(9 - row), static_cast<int8_t>(9 - column)};
+    }
+    
+    Move toMove(const BitBoard::Move& bitBoardMove)
+    {
+        Move move;
+        move.draught = _draughtsBySquare[bitBoardMove.from];
+        move.bitBoardMove = bitBoardMove;
+        
+        if (bitBoardMove.captures == 0) {
+            move.moves.emplace_back(toPosition(bitBoardMove.to));
+            return move;
+        }
         
-        for (int8_t i = 0; i < 4; ++i) {
-            int8_t dX = (i / 2) * 2 - 1;
-            int8_t dY = (((i+1) / 2) % 2) * 2 - 1;
+        // Walk every hop to find the captured piece in between, keeping the order of capture
+        Draught::Position position = toPosition(bitBoardMove.from);
+        for (int i = 0; i < bitBoardMove.captures; ++i) {
+            Draught::Position landing = toPosition(bitBoardMove.path[i]);
+            int8_t dX = landing.x > position.x ? 1 : -1;
+            int8_t dY = landing.y > position.y ? 1 : -1;
             
-            int8_t depth = lady ? 10 : 3;
-            for (int8_t j = 1; j < depth; ++j) {
-                int8_t x = position.x + dX * j;
-                int8_t y = position.y + dY * j;
-                
-                // Don't jump off the board, doesn't make sense to search further
-                if (x < 0 || x > 9 || y < 0 || y > 9) {
-                    break;
-                }
-                
-                // Need to land on a free field in the end
-                if (boardMatrix[y][x] != nullptr) {
-                    continue;
-                }
-                
-                bool isValidMove = true;
-                Draught* captured = nullptr;
-                for (int8_t k = 1; k < j; ++k) {
-                    int8_t xPath = position.x + dX * k;
-                    int8_t yPath = position.y + dY * k;
-                    if (boardMatrix[yPath][xPath] != nullptr) {
-                        if (turn == boardMatrix[yPath][xPath]->color()) {
-                            // Jumping over own pieces not allowed
-                            isValidMove = false;
-                            break;
-                        }
-                        
-                        if (captured != nullptr) {
-                            // Jumping over two at the same time not possible
-                            isValidMove = false;
-                            continue;
-                        }
-                        
-                        // Cannot capture which is already captured
-                        if (std::find(capturedIds.begin(), capturedIds.end(), boardMatrix[yPath][xPath]->id()) != capturedIds.end()) {
-                            break;
-                        }
-                        
-                        // Jumping over one is allowed and encouraged
-                        captured = boardMatrix[yPath][xPath];
-                    }
-                }
-                        
-                if (!isValidMove) {
-                    break;
-                }
-                
-                // Moving without capturing is only possible on the first move
-                if (captured == nullptr && !capturedIds.empty()) {
+            for (Draught::Position path{static_cast<int8_t>(position.x + dX), static_cast<int8_t>(position.y + dY)};
+                 path != landing;
+                 path = Draught::Position{static_cast<int8_t>(path.x + dX), static_cast<int8_t>(path.y + dY)}) {
+                int square = toSquare(path);
+                if (bitBoardMove.captured & BitBoard::mask(square)) {
+                    move.captured.emplace_back(_draughtsBySquare[square]);
                     break;
                 }
-                
-                if (captured == nullptr && !lady) {
-                    if (j > 1) {
-                        // Only ladies can jump more than one field without capturing
-                        break;
-                    } else if ((turn == Draught::Color::White && dX < 0) || (turn == Draught::Color::Black && dX > 0)) {
-                        // Only ladies can jump back without capturing
-                        break;
-                    }
-                }
-                
-                Draught::Position nextPosition{x, y};
-                
-                Move possibleMove;
-                possibleMove.draught = draught;
-                possibleMove.moves.emplace_back(nextPosition);
-                
-                // No followup moves possible without capture
-                if (captured == nullptr) {
-                    possibleMoves.emplace_back(possibleMove);
-                    continue;
-                }
-                
-                possibleMove.captured.emplace_back(captured);
-                
-                // Copy by value to keep the original values
-                auto nextCapturedIds = capturedIds;
-                nextCapturedIds.emplace_back(captured->id());
-                
-                BoardMatrix nextBoardMatrix = boardMatrix;
-                nextBoardMatrix[y][x] = draught;
-                nextBoardMatrix[captured->position().y][captured->position().x] = nullptr;
-                auto nextPossibleMoves = findMoves(nextBoardMatrix, draught, nextPosition, nextCapturedIds);
-                        
-                // If no further moves are possible, at least save this capture in the list of possible moves
-                if (nextPossibleMoves.empty()) {
-                    possibleMoves.emplace_back(possibleMove);
-                    continue;
-                }
-                        
-                // Otherwise, use the current move as the base to add the list of the other moves on top of it
-                for (const auto& nextPossibleMove : nextPossibleMoves) {
-                    Move move = possibleMove;
-                    move.moves.insert(move.moves.end(), nextPossibleMove.moves.begin(), nextPossibleMove.moves.end());
-                    move.captured.insert(move.captured.end(), nextPossibleMove.captured.begin(), nextPossibleMove.captured.end());
-                    
-                    possibleMoves.emplace_back(move);
-                }
             }
+            
+            move.moves.emplace_back(landing);
+            position = landing;
         }
         
-        return possibleMoves;
+        return move;
     }
-    
+
 private:
-    Draught::Color _turn{Draught::Color::White};
+    GameState _game;
     std::vector<Draught::Position> _playerMoves;
     
     std::shared_ptr<Object> _boardObject;
@@ -501,6 +348,7 @@ private:
     
     std::shared_ptr<Object> _draughtsObject;
     std::vector<Draught> _draughts;
+    DraughtsBySquare _draughtsBySquare;
     
     std::vector<int8_t> _capturedWhiteIds;
     std::vector<int8_t> _capturedBlackIds;
@@ -39,6 +39,10 @@ public:
             _scene->draughts()->move();
         });
         
+        _window->registerKeyCallback(GLFW_KEY_N, [this]() {
+            _scene->draughts()->moveNow();
+        });
+        
         _window->registerKeyCallback(GLFW_KEY_L, [this]() {
             _glassAlgo = (_glassAlgo + 1) % 2;
         });
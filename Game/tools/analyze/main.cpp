@@ -0,0 +1,172 @@
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "BatchAnalysis.hpp"
+#include "Evaluation.hpp"
+#include "Notation.hpp"
+#include "Pdn.hpp"
+#include "Search.hpp"
+#include "Tablebase.hpp"
+
+static void usage()
+{
+    std::cerr << "Usage: analyze [options]" << std::endl
+              << "  --pdn <file>        Analyze the position before every move of every game in the file" << std::endl
+              << "  --fens <file>       Analyze the positions in the file, one FEN per line" << std::endl
+              << "  --out <file>        Write the results to a file instead of the standard output" << std::endl
+              << "  --time <ms>         Time per position, 100 by default" << std::endl
+              << "  --depth <n>         Deepest depth searched per position, up to 63" << std::endl
+              << "  --nodes <n>         Nodes searched per position, no limit by default" << std::endl
+              << "  --threads <n>       Positions analyzed at the same time, one per core by default" << std::endl
+              << "  --hash <mb>         Transposition table size per thread, 16 by default" << std::endl
+              << "  --weights <file>    Evaluation weights" << std::endl
+              << "  --tablebase <dir>   Endgame tables" << std::endl;
+}
+
+/**
+ * Reads a depth limit, from one ply up to the deepest the search has room for.
+ */
+static bool parseDepth(const std::string& text, int& depth)
+{
+    char* end = nullptr;
+    long value = std::strtol(text.c_str(), &end, 10);
+    if (end == text.c_str() || *end != '\0' || value < 1 || value >= Search::kMaxPly) {
+        return false;
+    }
+    
+    depth = static_cast<int>(value);
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    BatchAnalysis::Options options;
+    options.limits.time = std::chrono::milliseconds(100);
+    std::string pdnFile;
+    std::string fenFile;
+    std::string outFile;
+    std::string weights;
+    std::string tablebase;
+    
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (argument == "--pdn" && hasValue) {
+            pdnFile = argv[++i];
+        } else if (argument == "--fens" && hasValue) {
+            fenFile = argv[++i];
+        } else if (argument == "--out" && hasValue) {
+            outFile = argv[++i];
+        } else if (argument == "--time" && hasValue) {
+            options.limits.time = std::chrono::milliseconds(std::atoi(argv[++i]));
+        } else if (argument == "--depth" && hasValue && parseDepth(argv[i + 1], options.limits.depth)) {
+            ++i;
+        } else if (argument == "--nodes" && hasValue) {
+            options.limits.nodes = std::strtoull(argv[++i], nullptr, 10);
+        } else if (argument == "--threads" && hasValue) {
+            options.threads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (argument == "--hash" && hasValue) {
+            options.hashMegabytes = std::strtoul(argv[++i], nullptr, 10);
+        } else if (argument == "--weights" && hasValue) {
+            weights = argv[++i];
+        } else if (argument == "--tablebase" && hasValue) {
+            tablebase = argv[++i];
+        } else {
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+    
+    if (pdnFile.empty() == fenFile.empty()) {
+        usage();
+        return EXIT_FAILURE;
+    }
+    
+    try {
+        if (!weights.empty()) {
+            options.evaluation = Evaluation(Evaluation::load(weights));
+        }
+        if (!tablebase.empty()) {
+            options.tablebase = std::make_shared<const Tablebase>(tablebase);
+        }
+        
+        std::ifstream input(pdnFile.empty() ? fenFile : pdnFile);
+        if (!input) {
+            throw std::runtime_error("can't read " + (pdnFile.empty() ? fenFile : pdnFile));
+        }
+        
+        std::ofstream outputFile;
+        if (!outFile.empty()) {
+            outputFile.open(outFile);
+            if (!outputFile) {
+                throw std::runtime_error("can't write " + outFile);
+            }
+        }
+        std::ostream& output = outFile.empty() ? std::cout : outputFile;
+        
+        // PDN positions are taken game by game and move by move, FENs line by line
+        std::vector<Pdn::Game> games = pdnFile.empty() ? std::vector<Pdn::Game>() : Pdn::parse(input);
+        size_t game = 0;
+        size_t ply = 0;
+        BitBoard board = games.empty() ? BitBoard() : games[0].start;
+        size_t line = 0;
+        
+        auto next = [&](BatchAnalysis::Position& position) {
+            if (pdnFile.empty()) {
+                std::string fen;
+                while (std::getline(input, fen)) {
+                    ++line;
+                    if (fen.empty()) {
+                        continue;
+                    }
+                    
+                    try {
+                        position.board = Notation::fromFen(fen);
+                    } catch (const std::runtime_error& e) {
+                        std::cerr << fenFile << ":" << line << ": " << e.what() << std::endl;
+                        continue;
+                    }
+                    position.id = std::to_string(line);
+                    return true;
+                }
+                
+                return false;
+            }
+            
+            while (game < games.size() && ply >= games[game].moves.size()) {
+                if (++game < games.size()) {
+                    board = games[game].start;
+                    ply = 0;
+                }
+            }
+            if (game >= games.size()) {
+                return false;
+            }
+            
+            position.id = std::to_string(game + 1) + "/" + std::to_string(ply + 1);
+            position.board = board;
+            board = board.apply(games[game].moves[ply++]);
+            return true;
+        };
+        
+        auto start = std::chrono::steady_clock::now();
+        BatchAnalysis analysis(options);
+        size_t positions = analysis.run(next, [&](const BatchAnalysis::Result& result) {
+            output << result.id << '\t' << Notation::fen(result.board) << '\t' << Notation::move(result.search.move) << '\t'
+                   << result.search.score << '\t' << result.search.depth << '\t' << result.search.nodes + result.search.qnodes << std::endl;
+        });
+        
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cerr << "Analyzed " << positions << " positions in " << elapsed << "s, "
+                  << positions / std::max(elapsed, 1e-9) << " positions/s" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,130 @@
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "BitBoard.hpp"
+#include "Notation.hpp"
+#include "OpeningBook.hpp"
+#include "OpeningBookBuilder.hpp"
+#include "SelfPlay.hpp"
+
+static void usage()
+{
+    std::cerr << "Usage: book [options]" << std::endl
+              << "  --out <file>       Book to write, opening.book by default" << std::endl
+              << "  --import <file>    Add the games in a file, one game per line, can be repeated" << std::endl
+              << "  --selfplay <n>     Add n games played by the computer against itself" << std::endl
+              << "  --time <ms>        Time per move in self-play games, 100 by default" << std::endl
+              << "  --opening <n>      Random plies before self-play games start, 2 by default" << std::endl
+              << "  --threads <n>      Self-play games played at the same time, one per core by default" << std::endl
+              << "  --plies <n>        Plies of every game that go into the book, 16 by default" << std::endl
+              << "  --min-games <n>    Games a move has to be played in, 2 by default" << std::endl
+              << "  --show <file>      Print the book moves of the initial position instead of building" << std::endl;
+}
+
+static void show(const std::string& path)
+{
+    OpeningBook book(path);
+    std::cout << book.size() << " entries" << std::endl;
+    for (auto&& [move, weight] : book.moves(BitBoard::initial())) {
+        std::cout << Notation::move(move) << ": " << weight << std::endl;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    OpeningBookBuilder::Options options;
+    SelfPlay::Options selfPlayOptions;
+    selfPlayOptions.games = 0;
+    selfPlayOptions.openingPlies = 2;
+    SelfPlay::Player player;
+    player.name = "book";
+    player.limits.time = std::chrono::milliseconds(100);
+    std::string out = "opening.book";
+    std::vector<std::string> imports;
+    
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (argument == "--out" && hasValue) {
+            out = argv[++i];
+        } else if (argument == "--import" && hasValue) {
+            imports.emplace_back(argv[++i]);
+        } else if (argument == "--selfplay" && hasValue) {
+            selfPlayOptions.games = std::strtoul(argv[++i], nullptr, 10);
+        } else if (argument == "--time" && hasValue) {
+            player.limits.time = std::chrono::milliseconds(std::atoi(argv[++i]));
+        } else if (argument == "--opening" && hasValue) {
+            selfPlayOptions.openingPlies = std::atoi(argv[++i]);
+        } else if (argument == "--threads" && hasValue) {
+            selfPlayOptions.threads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (argument == "--plies" && hasValue) {
+            options.plies = std::atoi(argv[++i]);
+        } else if (argument == "--min-games" && hasValue) {
+            options.minGames = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (argument == "--show" && hasValue) {
+            try {
+                show(argv[++i]);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return EXIT_FAILURE;
+            }
+            return EXIT_SUCCESS;
+        } else {
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+    
+    try {
+        OpeningBookBuilder builder(options);
+        for (auto&& path : imports) {
+            std::ifstream file(path);
+            if (!file) {
+                throw std::runtime_error("can't read " + path);
+            }
+            
+            std::string line;
+            for (int number = 1; std::getline(file, line); ++number) {
+                try {
+                    builder.add(line);
+                } catch (const std::runtime_error& e) {
+                    std::cerr << path << ":" << number << ": " << e.what() << std::endl;
+                }
+            }
+        }
+        
+        if (selfPlayOptions.games > 0) {
+            SelfPlay selfPlay(player, player, selfPlayOptions);
+            selfPlay.run([&](const SelfPlay::Game& game) {
+                std::vector<BitBoard::Move> moves;
+                for (auto&& played : game.moves) {
+                    moves.push_back(played.move);
+                }
+                
+                // Both players are the same, only the color of the winner matters
+                auto outcome = OpeningBookBuilder::Outcome::Draw;
+                if (game.outcome != SelfPlay::Outcome::Draw) {
+                    bool whiteWins = (game.outcome == SelfPlay::Outcome::FirstWins) == game.firstIsWhite;
+                    outcome = whiteWins ? OpeningBookBuilder::Outcome::WhiteWins : OpeningBookBuilder::Outcome::BlackWins;
+                }
+                builder.add(moves, outcome);
+                
+                if (builder.games() % 10 == 0) {
+                    std::cout << builder.games() << " games" << std::endl;
+                }
+            });
+        }
+        
+        builder.write(out);
+        std::cout << "Wrote " << builder.entries().size() << " entries from " << builder.games() << " games to " << out << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    
+    return EXIT_SUCCESS;
+}
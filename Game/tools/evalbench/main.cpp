@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "BatchEvaluation.hpp"
+#include "BitBoard.hpp"
+#include "Evaluation.hpp"
+
+static void usage()
+{
+    std::cerr << "Usage: evalbench [options]" << std::endl
+              << "  --positions <n>   Positions to evaluate, 1000000 by default" << std::endl
+              << "  --rounds <n>      Times every kernel evaluates all positions, 10 by default" << std::endl
+              << "  --seed <n>        Seed of the random games the positions are taken from" << std::endl
+              << "  --weights <file>  Evaluation weights, the default ones otherwise" << std::endl;
+}
+
+/**
+ * Positions from random games, so they cover all stages of a game.
+ */
+static PositionBatch randomPositions(size_t count, uint64_t seed)
+{
+    std::mt19937_64 random(seed);
+    PositionBatch batch;
+    BitBoard board = BitBoard::initial();
+    BitBoard::MoveList moves;
+    int ply = 0;
+    while (batch.size() < count) {
+        board.generate(moves);
+        if (moves.empty() || ply >= 200) {
+            board = BitBoard::initial();
+            ply = 0;
+            continue;
+        }
+        
+        board = board.apply(moves[std::uniform_int_distribution<size_t>(0, moves.size() - 1)(random)]);
+        ++ply;
+        batch.add(board);
+    }
+    
+    return batch;
+}
+
+static const char* name(BatchEvaluation::Kernel kernel)
+{
+    switch (kernel) {
+    case BatchEvaluation::Kernel::Avx2:
+        return "avx2";
+    case BatchEvaluation::Kernel::Neon:
+        return "neon";
+    default:
+        return "scalar";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    size_t count = 1000000;
+    int rounds = 10;
+    uint64_t seed = 1;
+    std::string weightsFile;
+    
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (argument == "--positions" && hasValue) {
+            count = std::strtoul(argv[++i], nullptr, 10);
+        } else if (argument == "--rounds" && hasValue) {
+            rounds = std::max(1, std::atoi(argv[++i]));
+        } else if (argument == "--seed" && hasValue) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (argument == "--weights" && hasValue) {
+            weightsFile = argv[++i];
+        } else {
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+    
+    try {
+        Evaluation evaluation = weightsFile.empty() ? Evaluation() : Evaluation(Evaluation::load(weightsFile));
+        auto batch = randomPositions(count, seed);
+        
+        std::vector<BitBoard> boards;
+        for (size_t i = 0; i < batch.size(); ++i) {
+            boards.push_back(batch.board(i));
+        }
+        
+        // The reference every vector kernel is checked against
+        std::vector<int32_t> expected(batch.size());
+        auto start = std::chrono::steady_clock::now();
+        for (int round = 0; round < rounds; ++round) {
+            for (size_t i = 0; i < boards.size(); ++i) {
+                expected[i] = evaluation.evaluate(boards[i]);
+            }
+        }
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double reference = rounds * batch.size() / std::max(elapsed, 1e-9);
+        std::cout << "evaluation: " << static_cast<uint64_t>(reference) << " positions/s" << std::endl;
+#ifndef NDEBUG
+        std::cout << "assertions are enabled, which slow the evaluation down, build with -DNDEBUG for timings" << std::endl;
+#endif
+        
+        bool matches = true;
+        BatchEvaluation batchEvaluation(evaluation);
+        std::vector<int32_t> scores(batch.size());
+        for (auto kernel : {BatchEvaluation::Kernel::Scalar, BatchEvaluation::Kernel::Avx2, BatchEvaluation::Kernel::Neon}) {
+            if (!BatchEvaluation::supported(kernel)) {
+                continue;
+            }
+            
+            batchEvaluation.setKernel(kernel);
+            start = std::chrono::steady_clock::now();
+            for (int round = 0; round < rounds; ++round) {
+                batchEvaluation.evaluate(batch, scores.data());
+            }
+            elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            
+            double speed = rounds * batch.size() / std::max(elapsed, 1e-9);
+            std::cout << name(kernel) << ": " << static_cast<uint64_t>(speed) << " positions/s, "
+                      << std::fixed << std::setprecision(1) << speed / reference << "x the evaluation" << std::defaultfloat;
+            
+            // The scalar kernel is the evaluation itself, only its overhead for the batch is worth timing
+            if (kernel == BatchEvaluation::Kernel::Scalar) {
+                std::cout << ", which it calls" << std::endl;
+                continue;
+            }
+            
+            size_t mismatches = 0;
+            for (size_t i = 0; i < batch.size(); ++i) {
+                mismatches += scores[i] != expected[i];
+            }
+            matches &= mismatches == 0;
+            std::cout << (mismatches == 0 ? " ok" : " FAILED, " + std::to_string(mismatches) + " scores differ") << std::endl;
+        }
+        
+        return matches ? EXIT_SUCCESS : EXIT_FAILURE;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Evaluation.hpp"
+#include "GameState.hpp"
+#include "Search.hpp"
+#include "SessionHost.hpp"
+
+static void usage()
+{
+    std::cerr << "Usage: loadgen [options]" << std::endl
+              << "  --clients <n>     Games played at the same time, 16 by default" << std::endl
+              << "  --moves <n>       Computer moves asked for per client, 50 by default" << std::endl
+              << "  --threads <n>     Threads searching for all games, one per core by default" << std::endl
+              << "  --time <ms>       Time per computer move, 50 by default" << std::endl
+              << "  --depth <n>       Deepest depth searched per move, up to 63" << std::endl
+              << "  --think <ms>      Time a client takes for its own move, 0 by default" << std::endl
+              << "  --hash <mb>       Transposition table size per game, 4 by default" << std::endl
+              << "  --max-plies <n>   Start a game over after this many plies, 200 by default" << std::endl
+              << "  --seed <n>        Seed of the clients' random moves" << std::endl
+              << "  --weights <file>  Evaluation weights" << std::endl;
+}
+
+/**
+ * Reads a depth limit, from one ply up to the deepest the search has room for.
+ */
+static bool parseDepth(const std::string& text, int& depth)
+{
+    char* end = nullptr;
+    long value = std::strtol(text.c_str(), &end, 10);
+    if (end == text.c_str() || *end != '\0' || value < 1 || value >= Search::kMaxPly) {
+        return false;
+    }
+    
+    depth = static_cast<int>(value);
+    return true;
+}
+
+struct Sample
+{
+    double latency;
+    double queued;
+    uint64_t nodes;
+};
+
+static double percentile(const std::vector<double>& sorted, double fraction)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    
+    size_t index = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+static void printLatencies(const std::string& name, std::vector<double> milliseconds)
+{
+    std::sort(milliseconds.begin(), milliseconds.end());
+    std::cout << std::fixed << std::setprecision(1) << name << " ms: p50 " << percentile(milliseconds, 0.5)
+              << ", p90 " << percentile(milliseconds, 0.9) << ", p99 " << percentile(milliseconds, 0.99)
+              << ", p99.9 " << percentile(milliseconds, 0.999) << ", max " << (milliseconds.empty() ? 0 : milliseconds.back())
+              << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    SessionHost::Options options;
+    options.limits.time = std::chrono::milliseconds(50);
+    size_t clients = 16;
+    int moves = 50;
+    int maxPlies = 200;
+    std::chrono::milliseconds think{0};
+    uint64_t seed = 1;
+    
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string argument = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (argument == "--clients" && hasValue) {
+                clients = std::strtoul(argv[++i], nullptr, 10);
+            } else if (argument == "--moves" && hasValue) {
+                moves = std::atoi(argv[++i]);
+            } else if (argument == "--threads" && hasValue) {
+                options.threads = std::strtoul(argv[++i], nullptr, 10);
+            } else if (argument == "--time" && hasValue) {
+                options.limits.time = std::chrono::milliseconds(std::atoi(argv[++i]));
+            } else if (argument == "--depth" && hasValue && parseDepth(argv[i + 1], options.limits.depth)) {
+                ++i;
+            } else if (argument == "--think" && hasValue) {
+                think = std::chrono::milliseconds(std::atoi(argv[++i]));
+            } else if (argument == "--hash" && hasValue) {
+                options.hashMegabytes = std::strtoul(argv[++i], nullptr, 10);
+            } else if (argument == "--max-plies" && hasValue) {
+                maxPlies = std::atoi(argv[++i]);
+            } else if (argument == "--seed" && hasValue) {
+                seed = std::strtoull(argv[++i], nullptr, 10);
+            } else if (argument == "--weights" && hasValue) {
+                options.evaluation = Evaluation(Evaluation::load(argv[++i]));
+            } else {
+                usage();
+                return EXIT_FAILURE;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    
+    SessionHost host(options);
+    std::mutex mutex;
+    std::vector<Sample> samples;
+    
+    // Every client plays random moves as white and waits for the computer's answer before its next move
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t client = 0; client < clients; ++client) {
+        threads.emplace_back([&, client]() {
+            std::mt19937_64 random(seed + client);
+            auto session = host.open();
+            std::vector<Sample> clientSamples;
+            for (int move = 0; move < moves; ++move) {
+                GameState game = host.state(session);
+                if (game.result() != GameState::Result::Ongoing || static_cast<int>(game.history().size()) >= maxPlies) {
+                    host.restart(session);
+                    game = host.state(session);
+                }
+                
+                std::this_thread::sleep_for(think);
+                const auto& legalMoves = game.legalMoves();
+                host.play(session, legalMoves[random() % legalMoves.size()]);
+                if (host.state(session).result() != GameState::Result::Ongoing) {
+                    continue;
+                }
+                
+                SessionHost::Reply reply;
+                try {
+                    reply = host.requestMove(session).get();
+                } catch (const std::exception& e) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    std::cerr << "game " << session << ": " << e.what() << std::endl;
+                    continue;
+                }
+                clientSamples.push_back(Sample{reply.latency.count() / 1000.0, reply.queued.count() / 1000.0,
+                                               reply.search.nodes + reply.search.qnodes});
+            }
+            host.close(session);
+            
+            std::lock_guard<std::mutex> lock(mutex);
+            samples.insert(samples.end(), clientSamples.begin(), clientSamples.end());
+        });
+    }
+    
+    for (auto&& thread : threads) {
+        thread.join();
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    
+    std::vector<double> latencies;
+    std::vector<double> queued;
+    uint64_t nodes = 0;
+    for (auto&& sample : samples) {
+        latencies.push_back(sample.latency);
+        queued.push_back(sample.queued);
+        nodes += sample.nodes;
+    }
+    
+    std::cout << samples.size() << " computer moves for " << clients << " clients on " << host.pool().threads()
+              << " threads in " << std::fixed << std::setprecision(2) << elapsed << "s, "
+              << samples.size() / std::max(elapsed, 1e-9) << " moves/s, "
+              << static_cast<uint64_t>(nodes / std::max(elapsed, 1e-9)) << " nodes/s, "
+              << host.pool().steals() << " steals" << std::endl;
+    printLatencies("Latency", latencies);
+    printLatencies("Queued", queued);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "BitBoard.hpp"
+#include "Notation.hpp"
+#include "Perft.hpp"
+#include "Variant.hpp"
+
+static void usage()
+{
+    std::cerr << "Usage: perft [options]" << std::endl
+              << "  --variant <name>  international (default), russian or english" << std::endl
+              << "  --fen <fen>       Position to count from, the initial position by default" << std::endl
+              << "  --depth <n>       Deepest depth to count, 6 by default" << std::endl
+              << "  --divide          Print the count per root move at the deepest depth" << std::endl
+              << "  --no-bulk         Play the moves of the last ply instead of counting them" << std::endl
+              << "  --hash <mb>       Cache subtree counts in a table of this size" << std::endl
+              << "  --copy-make       Copy the board for every move instead of making and taking back moves" << std::endl
+              << "  --compare         Time the deepest depth with both copy-make and make/unmake" << std::endl
+              << "  --verify          Compare against the published numbers of the reference positions" << std::endl;
+}
+
+struct Settings
+{
+    PerftOptions options;
+    std::string fen;
+    int depth{6};
+    bool divide{false};
+    bool verify{false};
+    bool compare{false};
+};
+
+/**
+ * The position written as FEN, or the initial position when there is none. Only international positions
+ * can be read from FEN.
+ */
+template <typename Variant>
+static BasicBitBoard<Variant> position(const std::string& fen)
+{
+    if (fen.empty()) {
+        return BasicBitBoard<Variant>::initial();
+    }
+    
+    if constexpr (std::is_same_v<Variant, International>) {
+        return Notation::fromFen(fen);
+    } else {
+        throw std::runtime_error("positions can only be given as FEN for international draughts");
+    }
+}
+
+/**
+ * Counts every depth up to `depth`, printing the nodes and throughput. Returns false when a count
+ * differs from the expected one.
+ */
+template <typename Variant>
+static bool count(PerftOptions options, const BasicBitBoard<Variant>& board, int depth, const std::vector<uint64_t>& expected = {})
+{
+    bool matches = true;
+    for (int d = 1; d <= depth; ++d) {
+        // A fresh cache per depth, so the timing doesn't benefit from the previous depth
+        BasicPerft<Variant> perft(options);
+        
+        auto start = std::chrono::steady_clock::now();
+        uint64_t nodes = perft.run(board, d);
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        
+        std::cout << "perft(" << d << ") = " << nodes << " in " << elapsed << "s, "
+                  << static_cast<uint64_t>(nodes / std::max(elapsed, 1e-9)) << " nodes/s";
+        if (d <= static_cast<int>(expected.size())) {
+            bool match = nodes == expected[d - 1];
+            matches &= match;
+            std::cout << (match ? " ok" : " FAILED, expected " + std::to_string(expected[d - 1]));
+        }
+        std::cout << std::endl;
+    }
+    
+    return matches;
+}
+
+/**
+ * Times the count at `depth` once copying the board for every move and once making and taking back moves
+ * on a single board. Bulk counting is off, so every leaf is actually played.
+ */
+template <typename Variant>
+static void compare(PerftOptions options, const BasicBitBoard<Variant>& board, int depth)
+{
+    options.bulk = false;
+    for (bool copyMake : {true, false}) {
+        options.copyMake = copyMake;
+        BasicPerft<Variant> perft(options);
+        
+        auto start = std::chrono::steady_clock::now();
+        uint64_t nodes = perft.run(board, depth);
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        
+        std::cout << (copyMake ? "copy-make:   " : "make/unmake: ") << nodes << " nodes in " << elapsed << "s, "
+                  << static_cast<uint64_t>(nodes / std::max(elapsed, 1e-9)) << " nodes/s" << std::endl;
+    }
+}
+
+template <typename Variant>
+static bool run(const Settings& settings)
+{
+    if (settings.verify) {
+        bool matches = true;
+        for (auto&& reference : BasicPerft<Variant>::references()) {
+            std::cout << reference.name << ": " << reference.fen << std::endl;
+            int referenceDepth = std::min(settings.depth, static_cast<int>(reference.nodes.size()));
+            matches &= count(settings.options, position<Variant>(reference.fen), referenceDepth, reference.nodes);
+        }
+        
+        return matches;
+    }
+    
+    auto board = position<Variant>(settings.fen);
+    if (settings.compare) {
+        compare(settings.options, board, settings.depth);
+    } else if (settings.divide) {
+        BasicPerft<Variant> perft(settings.options);
+        uint64_t total = 0;
+        for (auto&& [move, nodes] : perft.divide(board, settings.depth)) {
+            std::cout << move.from + 1 << (move.captures > 0 ? "x" : "-") << move.to + 1 << ": " << nodes << std::endl;
+            total += nodes;
+        }
+        std::cout << "Total: " << total << std::endl;
+    } else {
+        count(settings.options, board, settings.depth);
+    }
+    
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    Settings settings;
+    std::string variant = "international";
+    
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (argument == "--variant" && hasValue) {
+            variant = argv[++i];
+        } else if (argument == "--fen" && hasValue) {
+            settings.fen = argv[++i];
+        } else if (argument == "--depth" && hasValue) {
+            settings.depth = std::atoi(argv[++i]);
+        } else if (argument == "--hash" && hasValue) {
+            settings.options.hashMegabytes = std::strtoul(argv[++i], nullptr, 10);
+        } else if (argument == "--divide") {
+            settings.divide = true;
+        } else if (argument == "--no-bulk") {
+            settings.options.bulk = false;
+        } else if (argument == "--copy-make") {
+            settings.options.copyMake = true;
+        } else if (argument == "--compare") {
+            settings.compare = true;
+        } else if (argument == "--verify") {
+            settings.verify = true;
+        } else {
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+    
+    try {
+        bool success;
+        if (variant == "international") {
+            success = run<International>(settings);
+        } else if (variant == "russian") {
+            success = run<Russian>(settings);
+        } else if (variant == "english") {
+            success = run<English>(settings);
+        } else {
+            usage();
+            return EXIT_FAILURE;
+        }
+        
+        return success ? EXIT_SUCCESS : EXIT_FAILURE;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
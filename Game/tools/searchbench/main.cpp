@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Notation.hpp"
+#include "ParallelSearch.hpp"
+#include "Search.hpp"
+#include "TranspositionTable.hpp"
+
+static void usage()
+{
+    std::cerr << "Usage: searchbench [options]" << std::endl
+              << "  --fen <fen>       Position to search, can be repeated, a fixed set of positions by default" << std::endl
+              << "  --depth <n>       Depth searched per position, 8 by default, up to 63" << std::endl
+              << "  --hash <mb>       Transposition table size, 16 by default" << std::endl;
+}
+
+/**
+ * Reads a depth limit, from one ply up to the deepest the search has room for.
+ */
+static bool parseDepth(const std::string& text, int& depth)
+{
+    char* end = nullptr;
+    long value = std::strtol(text.c_str(), &end, 10);
+    if (end == text.c_str() || *end != '\0' || value < 1 || value >= Search::kMaxPly) {
+        return false;
+    }
+    
+    depth = static_cast<int>(value);
+    return true;
+}
+
+/**
+ * Positions from the opening to the endgame, taken from games of the engine against itself.
+ */
+static std::vector<std::string> defaultPositions()
+{
+    return {
+        Notation::fen(BitBoard::initial()),
+        "W:W27,29,31,32,35,37,40,41,42,44,45,46,47,48,49,50:B1,2,3,4,5,6,7,8,10,11,15,16,18,19,20,22",
+        "W:W29,31,33,34,35,39,45,46,47,48,49,50:B1,2,4,5,6,7,9,14,15,17,20,22,24,27,36",
+        "W:W28,34,38,42,45,46,47,50:B1,2,4,5,9,14,15,16,18,24,27,35,36",
+        "W:W40,47,50:B1,2,4,5,9,19,21,24,29,36"
+    };
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> fens;
+    int depth = 8;
+    size_t hashMegabytes = 16;
+    
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (argument == "--fen" && hasValue) {
+            fens.emplace_back(argv[++i]);
+        } else if (argument == "--depth" && hasValue && parseDepth(argv[i + 1], depth)) {
+            ++i;
+        } else if (argument == "--hash" && hasValue) {
+            hashMegabytes = std::strtoul(argv[++i], nullptr, 10);
+        } else {
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+    
+    if (fens.empty()) {
+        fens = defaultPositions();
+    }
+    
+    try {
+        // Every position is searched twice, a deterministic search has to give the same result both times no
+        // matter how many threads it could use
+        ParallelSearch search(std::make_shared<TranspositionTable>(hashMegabytes));
+        search.setDeterministic(true);
+        Search::Limits limits;
+        limits.depth = depth;
+        
+        bool matches = true;
+        uint64_t nodes = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (auto&& fen : fens) {
+            BitBoard board = Notation::fromFen(fen);
+            Search::Result first = search.run(board, limits).best;
+            Search::Result second = search.run(board, limits).best;
+            
+            bool match = first.move == second.move && first.score == second.score
+                      && first.nodes == second.nodes && first.qnodes == second.qnodes;
+            matches &= match;
+            nodes += 2 * (first.nodes + first.qnodes);
+            
+            std::cout << fen << ": " << Notation::move(first.move) << " score " << first.score << " nodes "
+                      << first.nodes + first.qnodes;
+            if (match) {
+                std::cout << " ok" << std::endl;
+            } else {
+                std::cout << " FAILED, then " << Notation::move(second.move) << " score " << second.score << " nodes "
+                          << second.nodes + second.qnodes << std::endl;
+            }
+        }
+        
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Total " << nodes << " nodes in " << elapsed << "s, "
+                  << static_cast<uint64_t>(nodes / std::max(elapsed, 1e-9)) << " nodes/s" << std::endl;
+        
+        return matches ? EXIT_SUCCESS : EXIT_FAILURE;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
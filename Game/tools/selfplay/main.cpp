@@ -0,0 +1,257 @@
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Evaluation.hpp"
+#include "Network.hpp"
+#include "Notation.hpp"
+#include "Pdn.hpp"
+#include "Search.hpp"
+#include "SearchLog.hpp"
+#include "SelfPlay.hpp"
+#include "TrainingData.hpp"
+
+static void usage()
+{
+    std::cerr << "Usage: selfplay [options]" << std::endl
+              << "  --games <n>       Games to play, 100 by default" << std::endl
+              << "  --threads <n>     Games played at the same time, one per core by default" << std::endl
+              << "  --opening <n>     Random plies played before the players take over, 4 by default" << std::endl
+              << "  --max-plies <n>   Adjudicate games as a draw after this many plies, 300 by default" << std::endl
+              << "  --seed <n>        Seed of the random openings" << std::endl
+              << "  --time1 <ms>      Time per move of the first player, 50 by default" << std::endl
+              << "  --time2 <ms>      Time per move of the second player, 50 by default" << std::endl
+              << "  --depth1 <n>      Deepest depth searched by the first player, up to 63" << std::endl
+              << "  --depth2 <n>      Deepest depth searched by the second player, up to 63" << std::endl
+              << "  --weights1 <file> Evaluation weights of the first player" << std::endl
+              << "  --weights2 <file> Evaluation weights of the second player" << std::endl
+              << "  --network1 <file> Neural network evaluation of the first player" << std::endl
+              << "  --network2 <file> Neural network evaluation of the second player" << std::endl
+              << "  --engine1 <name>  Search of the first player, alphabeta (default) or mcts" << std::endl
+              << "  --engine2 <name>  Search of the second player, alphabeta (default) or mcts" << std::endl
+              << "  --hash <mb>       Transposition table size per player, 16 by default" << std::endl
+              << "  --stats <file>    Write the search statistics of every move to a CSV file" << std::endl
+              << "  --json <file>     Append the full search statistics of every move to a file as JSON lines" << std::endl
+              << "  --training <file> Append the quiet positions searched, with score and outcome, to a training file" << std::endl
+              << "  --pdn <file>      Write the games to a PDN file" << std::endl;
+}
+
+static bool parseEngine(const std::string& name, Ai::Engine& engine)
+{
+    if (name == "alphabeta") {
+        engine = Ai::Engine::AlphaBeta;
+    } else if (name == "mcts") {
+        engine = Ai::Engine::MonteCarlo;
+    } else {
+        return false;
+    }
+    
+    return true;
+}
+
+/**
+ * Reads a depth limit, from one ply up to the deepest the search has room for.
+ */
+static bool parseDepth(const std::string& text, int& depth)
+{
+    char* end = nullptr;
+    long value = std::strtol(text.c_str(), &end, 10);
+    if (end == text.c_str() || *end != '\0' || value < 1 || value >= Search::kMaxPly) {
+        return false;
+    }
+    
+    depth = static_cast<int>(value);
+    return true;
+}
+
+/**
+ * The quiet positions the players searched, those without captures, labelled with the score of the search
+ * and the outcome of the game. Positions with a forced win or only one move are left out, and so are the
+ * moves of a Monte Carlo player, whose score is an expected outcome instead of centipieces.
+ */
+static std::vector<TrainingData::Record> trainingRecords(const SelfPlay::Game& game, const SelfPlay::Player& first,
+                                                         const SelfPlay::Player& second)
+{
+    bool whiteWins = (game.outcome == SelfPlay::Outcome::FirstWins) == game.firstIsWhite;
+    std::vector<TrainingData::Record> records;
+    for (auto&& played : game.moves) {
+        if (played.opening || (played.first ? first : second).engine != Ai::Engine::AlphaBeta
+         || played.move.captures > 0 || played.search.depth == 0 || played.search.fromBook
+         || std::abs(played.search.score) >= Search::kWin - Search::kMaxPly) {
+            continue;
+        }
+        
+        int result = game.outcome == SelfPlay::Outcome::Draw ? 0 : whiteWins == (played.board.turn == BitBoard::Color::White) ? 1 : -1;
+        records.push_back(TrainingData::record(played.board, played.search.score, result));
+    }
+    
+    return records;
+}
+
+static void printScore(const SelfPlay::Score& score)
+{
+    std::cout << "Games: " << score.games() << ", +" << score.wins << " =" << score.draws << " -" << score.losses
+              << ", score " << std::fixed << std::setprecision(1) << 100 * score.ratio() << "%, Elo "
+              << std::showpos << score.elo() << std::noshowpos << " +/- " << score.eloMargin() << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    SelfPlay::Options options;
+    SelfPlay::Player first;
+    first.name = "first";
+    SelfPlay::Player second;
+    second.name = "second";
+    std::string statsFile;
+    std::string jsonFile;
+    std::string trainingFile;
+    std::string pdnFile;
+    
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (argument == "--games" && hasValue) {
+            options.games = std::strtoul(argv[++i], nullptr, 10);
+        } else if (argument == "--threads" && hasValue) {
+            options.threads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (argument == "--opening" && hasValue) {
+            options.openingPlies = std::atoi(argv[++i]);
+        } else if (argument == "--max-plies" && hasValue) {
+            options.maxPlies = std::atoi(argv[++i]);
+        } else if (argument == "--seed" && hasValue) {
+            options.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (argument == "--time1" && hasValue) {
+            first.limits.time = std::chrono::milliseconds(std::atoi(argv[++i]));
+        } else if (argument == "--time2" && hasValue) {
+            second.limits.time = std::chrono::milliseconds(std::atoi(argv[++i]));
+        } else if (argument == "--depth1" && hasValue && parseDepth(argv[i + 1], first.limits.depth)) {
+            ++i;
+        } else if (argument == "--depth2" && hasValue && parseDepth(argv[i + 1], second.limits.depth)) {
+            ++i;
+        } else if (argument == "--weights1" && hasValue) {
+            first.weights = argv[++i];
+        } else if (argument == "--weights2" && hasValue) {
+            second.weights = argv[++i];
+        } else if (argument == "--network1" && hasValue) {
+            first.network = argv[++i];
+        } else if (argument == "--network2" && hasValue) {
+            second.network = argv[++i];
+        } else if (argument == "--engine1" && hasValue && parseEngine(argv[i + 1], first.engine)) {
+            ++i;
+        } else if (argument == "--engine2" && hasValue && parseEngine(argv[i + 1], second.engine)) {
+            ++i;
+        } else if (argument == "--hash" && hasValue) {
+            first.hashMegabytes = second.hashMegabytes = std::strtoul(argv[++i], nullptr, 10);
+        } else if (argument == "--stats" && hasValue) {
+            statsFile = argv[++i];
+        } else if (argument == "--json" && hasValue) {
+            jsonFile = argv[++i];
+        } else if (argument == "--training" && hasValue) {
+            trainingFile = argv[++i];
+        } else if (argument == "--pdn" && hasValue) {
+            pdnFile = argv[++i];
+        } else {
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+    
+    std::ofstream stats;
+    if (!statsFile.empty()) {
+        stats.open(statsFile);
+        if (!stats) {
+            std::cerr << "Can't write " << statsFile << std::endl;
+            return EXIT_FAILURE;
+        }
+        stats << "game,ply,player,move,depth,score,nodes,qnodes,firstMoveCutoffRate,milliseconds" << std::endl;
+    }
+    
+    // Fail before starting any game when a weights or network file is broken
+    std::unique_ptr<SearchLog> searchLog;
+    try {
+        for (auto&& player : {first, second}) {
+            if (!player.weights.empty()) {
+                Evaluation::load(player.weights);
+            }
+            if (!player.network.empty()) {
+                Network network(player.network);
+            }
+        }
+        
+        if (!jsonFile.empty()) {
+            searchLog = std::make_unique<SearchLog>(jsonFile);
+        }
+        if (!trainingFile.empty()) {
+            TrainingData::append(trainingFile, {});
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    
+    std::ofstream pdn;
+    if (!pdnFile.empty()) {
+        pdn.open(pdnFile);
+        if (!pdn) {
+            std::cerr << "Can't write " << pdnFile << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    
+    SelfPlay selfPlay(first, second, options);
+    auto score = selfPlay.run([&](const SelfPlay::Game& game) {
+        std::cout << "Game " << game.index + 1 << ": " << (game.firstIsWhite ? first.name : second.name) << " (white) vs "
+                  << (game.firstIsWhite ? second.name : first.name) << " (black), " << game.moves.size() << " plies, "
+                  << (game.outcome == SelfPlay::Outcome::Draw ? "draw" : game.outcome == SelfPlay::Outcome::FirstWins ? first.name + " wins" : second.name + " wins")
+                  << std::endl;
+        
+        if (!trainingFile.empty()) {
+            TrainingData::append(trainingFile, trainingRecords(game, first, second));
+        }
+        
+        if (pdn.is_open()) {
+            Pdn::Game record;
+            record.setTag("Event", "Self-play");
+            record.setTag("Round", std::to_string(game.index + 1));
+            record.setTag("White", game.firstIsWhite ? first.name : second.name);
+            record.setTag("Black", game.firstIsWhite ? second.name : first.name);
+            for (auto&& played : game.moves) {
+                record.moves.push_back(played.move);
+            }
+            
+            bool whiteWins = (game.outcome == SelfPlay::Outcome::FirstWins) == game.firstIsWhite;
+            record.result = game.outcome == SelfPlay::Outcome::Draw ? "1-1" : whiteWins ? "2-0" : "0-2";
+            pdn << Pdn::write(record) << std::endl;
+        }
+        
+        for (size_t ply = 0; ply < game.moves.size(); ++ply) {
+            const auto& played = game.moves[ply];
+            if (played.opening) {
+                continue;
+            }
+            
+            if (searchLog) {
+                searchLog->write("{\"game\":" + std::to_string(game.index + 1) + ",\"ply\":" + std::to_string(ply + 1)
+                                 + ",\"player\":\"" + (played.first ? first.name : second.name) + "\",\"search\":"
+                                 + SearchLog::json(played.search) + "}");
+            }
+            
+            if (!stats.is_open()) {
+                continue;
+            }
+            
+            stats << game.index + 1 << ',' << ply + 1 << ',' << (played.first ? first.name : second.name) << ','
+                  << Notation::move(played.move) << ',' << played.search.depth << ',' << played.search.score << ','
+                  << played.search.nodes << ',' << played.search.qnodes << ','
+                  << played.search.firstMoveCutoffRate() << ',' << played.search.elapsed.count() << '\n';
+        }
+    });
+    
+    printScore(score);
+    return EXIT_SUCCESS;
+}
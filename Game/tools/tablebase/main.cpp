@@ -0,0 +1,87 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "Notation.hpp"
+#include "Tablebase.hpp"
+#include "TablebaseGenerator.hpp"
+
+static void usage()
+{
+    std::cerr << "Usage: tablebase [options]" << std::endl
+              << "  --pieces <n>    Generate all positions with up to this many pieces, 4 by default" << std::endl
+              << "  --dir <path>    Directory of the tables, tablebases by default" << std::endl
+              << "  --threads <n>   Threads generating, one per core by default" << std::endl
+              << "  --probe <fen>   Print the outcome of a position instead of generating" << std::endl;
+}
+
+static std::string name(Tablebase::Value value)
+{
+    switch (value) {
+        case Tablebase::Value::Win:
+            return "win";
+        case Tablebase::Value::Loss:
+            return "loss";
+        case Tablebase::Value::Draw:
+            return "draw";
+        default:
+            return "invalid";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    TablebaseGenerator::Options options;
+    std::string probe;
+    
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (argument == "--pieces" && hasValue) {
+            options.pieces = std::atoi(argv[++i]);
+        } else if (argument == "--dir" && hasValue) {
+            options.directory = argv[++i];
+        } else if (argument == "--threads" && hasValue) {
+            options.threads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (argument == "--probe" && hasValue) {
+            probe = argv[++i];
+        } else {
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+    
+    try {
+        if (!probe.empty()) {
+            Tablebase tablebase(options.directory);
+            Tablebase::Value value;
+            if (!tablebase.probe(Notation::fromFen(probe), value)) {
+                std::cerr << "No table for this position" << std::endl;
+                return EXIT_FAILURE;
+            }
+            
+            std::cout << name(value) << " for the side to move" << std::endl;
+            return EXIT_SUCCESS;
+        }
+        
+        auto start = std::chrono::steady_clock::now();
+        TablebaseGenerator generator(options);
+        generator.run([&](const TablebaseGenerator::Progress& progress) {
+            auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cout << progress.material.name() << ": " << progress.positions << " positions";
+            if (progress.loaded) {
+                std::cout << ", already generated" << std::endl;
+                return;
+            }
+            
+            std::cout << ", " << progress.wins << " wins, " << progress.draws << " draws, " << progress.losses << " losses in "
+                      << progress.passes << " passes, " << elapsed << "s" << std::endl;
+        });
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    
+    return EXIT_SUCCESS;
+}
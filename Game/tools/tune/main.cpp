@@ -0,0 +1,115 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Evaluation.hpp"
+#include "EvaluationTuner.hpp"
+#include "TrainingData.hpp"
+
+static void usage()
+{
+    std::cerr << "Usage: tune [options] --data <file>" << std::endl
+              << "  --data <file>     Training data written by selfplay --training, can be repeated" << std::endl
+              << "  --out <file>      Weights file to write, draughts.weights by default" << std::endl
+              << "  --weights <file>  Weights to start from, the default weights otherwise" << std::endl
+              << "  --threads <n>     Threads scoring the positions, one per core by default" << std::endl
+              << "  --step <n>        First amount the weights are changed by, 8 by default" << std::endl
+              << "  --passes <n>      Passes over all weights at most, 100 by default" << std::endl
+              << "  --all             Keep positions with captures as well, only quiet ones by default" << std::endl;
+}
+
+static void printWeights(const Evaluation::Weights& weights)
+{
+    std::cout << "man " << weights.man << ", king " << weights.king << ", tempo " << weights.tempo
+              << ", center " << weights.center << ", backRank " << weights.backRank << ", mobility " << weights.mobility
+              << ", advancement";
+    for (auto&& advancement : weights.advancement) {
+        std::cout << " " << advancement;
+    }
+    std::cout << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    EvaluationTuner::Options options;
+    std::vector<std::string> dataFiles;
+    std::string out = "draughts.weights";
+    std::string weightsFile;
+    bool all = false;
+    
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (argument == "--data" && hasValue) {
+            dataFiles.emplace_back(argv[++i]);
+        } else if (argument == "--out" && hasValue) {
+            out = argv[++i];
+        } else if (argument == "--weights" && hasValue) {
+            weightsFile = argv[++i];
+        } else if (argument == "--threads" && hasValue) {
+            options.threads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (argument == "--step" && hasValue) {
+            options.step = std::atoi(argv[++i]);
+        } else if (argument == "--passes" && hasValue) {
+            options.passes = std::atoi(argv[++i]);
+        } else if (argument == "--all") {
+            all = true;
+        } else {
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+    
+    if (dataFiles.empty()) {
+        usage();
+        return EXIT_FAILURE;
+    }
+    
+    try {
+        auto start = std::chrono::steady_clock::now();
+        Evaluation::Weights weights = weightsFile.empty() ? Evaluation::Weights() : Evaluation::load(weightsFile);
+        EvaluationTuner tuner(options);
+        size_t read = 0;
+        for (auto&& path : dataFiles) {
+            for (auto&& record : TrainingData::read(path)) {
+                BitBoard board = TrainingData::board(record);
+                if (all || EvaluationTuner::quiet(board)) {
+                    tuner.add(board, record.result);
+                }
+                ++read;
+            }
+        }
+        
+        auto loaded = std::chrono::steady_clock::now();
+        std::cout << "Kept " << tuner.size() << " of " << read << " positions in "
+                  << std::fixed << std::setprecision(2) << std::chrono::duration<double>(loaded - start).count() << "s" << std::endl;
+        if (tuner.size() == 0) {
+            std::cerr << "no positions to tune on" << std::endl;
+            return EXIT_FAILURE;
+        }
+        
+        double scale = tuner.fitScale(weights);
+        std::cout << std::setprecision(6) << "Scale " << scale << ", error " << tuner.error(weights, scale) << std::endl;
+        printWeights(weights);
+        
+        weights = tuner.tune(weights, scale, [&](const EvaluationTuner::Progress& progress) {
+            std::cout << "Pass " << progress.pass << ", step " << progress.step << ", error " << progress.error << std::endl;
+            
+            // Saved after every pass, so stopping a long run early still leaves the best weights so far
+            Evaluation::save(out, progress.weights);
+        });
+        
+        Evaluation::save(out, weights);
+        printWeights(weights);
+        std::cout << "Wrote " << out << " in " << std::setprecision(2)
+                  << std::chrono::duration<double>(std::chrono::steady_clock::now() - loaded).count() << "s" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    
+    return EXIT_SUCCESS;
+}